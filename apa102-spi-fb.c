@@ -29,16 +29,12 @@
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/spi/spi.h>
+#include <linux/vmalloc.h>
 
 #include "rgbled-fb.h"
 
 #define DEVICE_NAME "apa102-spi-fb"
 
-/* an encoded rgb-pixel */
-struct apa102_pixel {
-	u8 brightness, b, g, r;
-};
-
 /* generic information about this device */
 struct apa102_device_info {
 	char *name;
@@ -49,71 +45,20 @@ struct apa102_device_info {
 	u32 led_current_base;
 };
 
+/* the data of an individual output */
+struct apa102_output {
+	struct rgbled_spi_output spi_out;
+};
+
 /* the private data structure for this device */
 struct apa102_data {
 	struct spi_device *spi;
 	struct rgbled_fb *rgbled_fb;
-	struct apa102_pixel *spi_data;
-	struct spi_message spi_msg;
-	struct spi_transfer spi_xfer;
+	struct apa102_output *outputs;
 };
 
 static const struct of_device_id apa102_of_match[];
 
-/* define the different FB types */
-struct rgbled_panel_info apa102_panels[] = {
-	{
-		.compatible	= "shiji-led,apa102,strip",
-		.width		= 1,
-		.height		= 1,
-		.pitch		= 30,
-		.flags		= RGBLED_FLAG_CHANGE_WHLP,
-	},
-	{
-		.compatible	= "shiji-led,apa102,strip,30",
-		.width		= 1,
-		.height		= 1,
-		.pitch		= 30,
-		.flags		= RGBLED_FLAG_CHANGE_WHL,
-	},
-	{
-		.compatible	= "shiji-led,apa102,strip,60",
-		.width		= 1,
-		.height		= 1,
-		.pitch		= 60,
-		.flags		= RGBLED_FLAG_CHANGE_WHL,
-	},
-	{
-		.compatible	= "shiji-led,apa102,strip,144",
-		.width		= 1,
-		.height		= 1,
-		.pitch		= 144,
-		.flags		= RGBLED_FLAG_CHANGE_WHL,
-	},
-	{
-		.compatible	= "adafruit,dotstar,strip,30",
-		.width		= 1,
-		.height		= 1,
-		.pitch		= 30,
-		.flags		= RGBLED_FLAG_CHANGE_WHL,
-	},
-	{
-		.compatible	= "adafruit,dotstar,strip,60",
-		.width		= 1,
-		.height		= 1,
-		.pitch		= 60,
-		.flags		= RGBLED_FLAG_CHANGE_WHL,
-	},
-	{
-		.compatible	= "adafruit,dotstar,strip,144",
-		.width		= 1,
-		.height		= 1,
-		.pitch		= 144,
-		.flags		= RGBLED_FLAG_CHANGE_WHL,
-	},
-	{ }
-};
-
 static struct apa102_device_info apa102_device_info = {
 	.name			= "apa102-spi-fb",
 	.panels			= apa102_panels,
@@ -129,74 +74,130 @@ static void apa102_set_pixel_value(struct rgbled_fb *rfb,
 				   struct rgbled_pixel *pix)
 {
 	struct apa102_data *bs = rfb->par;
-	struct apa102_pixel *spix = &bs->spi_data[pixel_num + 1];
+	struct apa102_pixel *data =
+		rgbled_spi_output_buffer(&bs->outputs[panel->output].spi_out);
 
-	spix->brightness = 0xe0 | (pix->brightness >> 3);
-	spix->r = pix->red;
-	spix->g = pix->green;
-	spix->b = pix->blue;
+	/* the start frame goes first */
+	rgbled_encode_apa102(&data[pixel_num + 1], pix, 1);
 }
 
 static void apa102_finish_work(struct rgbled_fb *rfb)
 {
 	struct apa102_data *bs = rfb->par;
+	struct rgbled_panel_info *panel;
+	int i;
+
+	/* the panels that did not get encoded stay as they were */
+	list_for_each_entry(panel, &rfb->panels, list)
+		if (!panel->dirty)
+			rgbled_spi_output_keep(
+				&bs->outputs[panel->output].spi_out,
+				(panel->output_pixel + 1) *
+				sizeof(struct apa102_pixel),
+				panel->pixel * sizeof(struct apa102_pixel));
+
+	/* hand the frame to the spi outputs - not waiting for them,
+	 * so outputs on separate spi buses transmit concurrently
+	 */
+	for (i = 0; i < rfb->outputs; i++)
+		rgbled_spi_output_submit(&bs->outputs[i].spi_out);
+}
+
+static int apa102_probe_output(struct apa102_data *bs, u32 output)
+{
+	struct rgbled_fb *rfb = bs->rgbled_fb;
+	struct apa102_output *out = &bs->outputs[output];
+	struct device *dev = &bs->spi->dev;
+	struct apa102_pixel *frame;
+	struct spi_device *spi;
+	u32 pixel = rgbled_output_pixel(rfb, output);
+	int len, err;
 
-	/* just issue spi_sync on the prepared spi message */
-	spi_sync(bs->spi, &bs->spi_msg);
+	/* a gap in the output numbers leaves an output without leds */
+	if (!pixel) {
+		dev_err(dev, "output %u has no panels connected\n", output);
+		return -EINVAL;
+	}
+
+	spi = rgbled_spi_output_device(rfb, bs->spi, output);
+	if (IS_ERR(spi))
+		return PTR_ERR(spi);
+
+	/* set up the spi-message and buffers */
+	len = rgbled_apa102_frame_len(pixel);
+	frame = vmalloc(len);
+	if (!frame)
+		return -ENOMEM;
+	rgbled_apa102_frame_init(frame, pixel);
+
+	/* setting up SPI - the frames get encoded right into the
+	 * transmit buffers of the output, which all start out with
+	 * the start frame and the trailing clocks
+	 * (the clock is ours, so pauses between segments do no harm)
+	 */
+	err = rgbled_spi_output_init(&out->spi_out, rfb, spi, len,
+				     sizeof(struct apa102_pixel), frame);
+	vfree(frame);
+	if (err)
+		return err;
+
+	return 0;
 }
 
 static int apa102_probe(struct spi_device *spi)
 {
+	struct rgbled_platform_data *pdata = dev_get_platdata(&spi->dev);
 	struct apa102_data *bs;
-	int len;
+	int i, err;
 	const struct of_device_id *of_id;
+	const struct spi_device_id *id;
 	const struct apa102_device_info *dinfo;
 	struct rgbled_fb *rfb;
 
-	/* get the panels for this panel */
+	/* get the panels for this panel - via device-tree or spi_device_id */
 	of_id = of_match_device(apa102_of_match, &spi->dev);
-	if (!of_id)
+	id = spi_get_device_id(spi);
+	if (of_id)
+		dinfo = (const struct apa102_device_info *)of_id->data;
+	else if (id)
+		dinfo = (const struct apa102_device_info *)id->driver_data;
+	else
 		return -EINVAL;
-	dinfo = (const struct apa102_device_info *)of_id->data;
+
+	/* without device-tree the layout comes with the platform data */
+	if ((!spi->dev.of_node) && (!pdata)) {
+		dev_err(&spi->dev, "no device-tree node or platform data\n");
+		return -EINVAL;
+	}
 
 	/* allocate our buffer */
 	bs = devm_kzalloc(&spi->dev, sizeof(*bs), GFP_KERNEL);
 	if (!bs)
 		return -ENOMEM;
 
-	rfb = rgbled_alloc(&spi->dev, DEVICE_NAME, apa102_panels);
+	rfb = rgbled_alloc(&spi->dev, DEVICE_NAME,
+			   pdata ? pdata->panels : dinfo->panels);
 	bs->rgbled_fb = rfb;
 	if (!bs->rgbled_fb)
 		return -ENOMEM;
 	if (IS_ERR(bs->rgbled_fb))
 		return PTR_ERR(bs->rgbled_fb);
 
-	/* set up the spi-message and buffers */
-	len =
-	      /* start frame + pixel data themselves */
-	      + (bs->rgbled_fb->pixel + 1) * sizeof(struct apa102_pixel)
-	      /* end signal - extra clocks needed for propagation*/
-	      + bs->rgbled_fb->pixel / 8 + 1;
-	bs->spi_data = devm_kzalloc(&spi->dev, len, GFP_KERNEL);
-	if (!bs->spi_data)
-		return -ENOMEM;
-	/* fill in the "trailing" clocks */
-	memset(&bs->spi_data[bs->rgbled_fb->pixel + 1],
-	       255, bs->rgbled_fb->pixel / 8 + 1);
-
-	/* setting up SPI */
+	/* set up the individual outputs */
 	bs->spi = spi;
-	spi_message_init(&bs->spi_msg);
-	bs->spi_xfer.len = len;
-	bs->spi_xfer.tx_buf = bs->spi_data;
-	spi_message_add_tail(&bs->spi_xfer, &bs->spi_msg);
-
-	/* and estimate the refresh rate */
-	rfb->deferred_io.delay = max_t(unsigned long, 1,
-				       HZ * len * 8 / spi->max_speed_hz);
+	bs->outputs = devm_kcalloc(&spi->dev, rfb->outputs,
+				   sizeof(*bs->outputs), GFP_KERNEL);
+	if (!bs->outputs)
+		return -ENOMEM;
+	for (i = 0; i < rfb->outputs; i++) {
+		err = apa102_probe_output(bs, i);
+		if (err)
+			return err;
+	}
 
-	/* setting up deferred work */
+	/* setting up deferred work - dimming with the current level */
 	bs->rgbled_fb->set_pixel_value = apa102_set_pixel_value;
+	bs->rgbled_fb->hw_brightness = true;
 	bs->rgbled_fb->finish_work = apa102_finish_work;
 
 	/* copy the current values */
@@ -204,6 +205,8 @@ static int apa102_probe(struct spi_device *spi)
 	rfb->led_current_max_green = dinfo->led_current_max_green;
 	rfb->led_current_max_blue = dinfo->led_current_max_blue;
 	rfb->led_current_base = dinfo->led_current_base;
+	if (pdata)
+		rfb->current_limit = pdata->current_limit;
 
 	/* set the reverse pointer */
 	rfb->par = bs;
@@ -221,12 +224,20 @@ static const struct of_device_id apa102_of_match[] = {
 };
 MODULE_DEVICE_TABLE(of, apa102_of_match);
 
+/* and the same for instantiation with platform data */
+static const struct spi_device_id apa102_id_table[] = {
+	{ "apa102", (kernel_ulong_t)&apa102_device_info },
+	{ }
+};
+MODULE_DEVICE_TABLE(spi, apa102_id_table);
+
 static struct spi_driver apa102_driver = {
 	.driver = {
 		.name = DEVICE_NAME,
 		.owner = THIS_MODULE,
 		.of_match_table = apa102_of_match,
 	},
+	.id_table = apa102_id_table,
 	.probe = apa102_probe,
 };
 module_spi_driver(apa102_driver);
@@ -24,11 +24,17 @@
 #include <linux/list.h>
 #include <linux/list_sort.h>
 #include <linux/module.h>
+#include <linux/slab.h>
 #include <linux/spi/spi.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
 #include <linux/vmalloc.h>
 
 #include "rgbled-fb.h"
 
+#define CREATE_TRACE_POINTS
+#include "rgbled-fb-trace.h"
+
 /* exposure of component data in sysfs */
 #if 0
 #define SYSFS_PANEL_HELPER_SHOW(name, field)				\
@@ -84,6 +90,27 @@ static int rgbled_register_sysfs_panels(struct rgbled_fb *rfb)
 	return 0;
 }
 
+/* the length of a frame slot - at least the time on the wire */
+static u64 rgbled_frame_period_ns(struct rgbled_fb *rfb)
+{
+	u64 period = 0;
+
+	if (rfb->refresh_rate_hz)
+		period = NSEC_PER_SEC / rfb->refresh_rate_hz;
+
+	return max(period, rfb->frame_wire_ns);
+}
+
+/* the next slot after the last frame - or right now - with frame_lock */
+static ktime_t rgbled_next_frame_slot(struct rgbled_fb *rfb)
+{
+	ktime_t now = ktime_get();
+	ktime_t next = ktime_add_ns(rfb->frame_last,
+				    rgbled_frame_period_ns(rfb));
+
+	return ktime_before(next, now) ? now : next;
+}
+
 #define SYSFS_HELPER_SHOW(name, field)					\
 	static ssize_t name ## _show(struct device *dev,		\
 				struct device_attribute *a,		\
@@ -121,6 +148,7 @@ static int rgbled_register_sysfs_panels(struct rgbled_fb *rfb)
 		rfb->current_max = 0;					\
 		spin_unlock(&rfb->lock);				\
 									\
+		rgbled_damage_all(rfb);					\
 		rgbled_schedule(fb);					\
 									\
 		return count;						\
@@ -139,6 +167,7 @@ static int rgbled_register_sysfs_panels(struct rgbled_fb *rfb)
 #undef current
 
 SYSFS_HELPER_RW(brightness, brightness, 255);
+SYSFS_HELPER_RO(brightness_effective, brightness_effective);
 SYSFS_HELPER_RO(current, current_active);
 SYSFS_HELPER_RO(current_max, current_max);
 SYSFS_HELPER_RW(current_limit, current_limit, 100000000);
@@ -148,9 +177,170 @@ SYSFS_HELPER_RW(led_current_max_blue, led_current_max_blue, 10000);
 SYSFS_HELPER_RW(led_current_base, led_current_base, 10000);
 SYSFS_HELPER_RO(led_count, pixel);
 SYSFS_HELPER_RO(updates, screen_updates);
+SYSFS_HELPER_SHOW(dither, dither)
+SYSFS_HELPER_SHOW(refresh_rate_hz, refresh_rate_hz)
+SYSFS_HELPER_RO(frame_count, frame_count);
+
+/* switching dithering only needs a re-encode - not a full redraw */
+static ssize_t dither_store(struct device *dev,
+			    struct device_attribute *a,
+			    const char *buf, size_t count)
+{
+	struct fb_info *fb = dev_get_drvdata(dev);
+	struct rgbled_fb *rfb = fb->par;
+	int err;
+	u32 val;
+
+	err = kstrtou32(buf, 0, &val);
+	if (err)
+		return err;
+	if (val > 1)
+		return -EINVAL;
+
+	spin_lock(&rfb->lock);
+	rfb->dither = val;
+	spin_unlock(&rfb->lock);
+
+	rgbled_schedule(fb);
+
+	return count;
+}
+static DEVICE_ATTR_RW(dither);
+
+/* a new rate moves the frame already waiting for its slot */
+static ssize_t refresh_rate_hz_store(struct device *dev,
+				     struct device_attribute *a,
+				     const char *buf, size_t count)
+{
+	struct fb_info *fb = dev_get_drvdata(dev);
+	struct rgbled_fb *rfb = fb->par;
+	unsigned long flags;
+	int err;
+	u32 val;
+
+	err = kstrtou32(buf, 0, &val);
+	if (err)
+		return err;
+	if (val > 10000)
+		return -EINVAL;
+
+	spin_lock_irqsave(&rfb->frame_lock, flags);
+	rfb->refresh_rate_hz = val;
+	/* only if the timer is still pending - not if it already fired */
+	if ((rfb->frame_scheduled) &&
+	    (hrtimer_try_to_cancel(&rfb->frame_timer) == 1))
+		hrtimer_start(&rfb->frame_timer, rgbled_next_frame_slot(rfb),
+			      HRTIMER_MODE_ABS);
+	spin_unlock_irqrestore(&rfb->frame_lock, flags);
+
+	return count;
+}
+static DEVICE_ATTR_RW(refresh_rate_hz);
+
+/* the time the last frame got transmitted (CLOCK_MONOTONIC in ns) */
+static ssize_t frame_timestamp_show(struct device *dev,
+				    struct device_attribute *a,
+				    char *buf)
+{
+	struct fb_info *fb = dev_get_drvdata(dev);
+	struct rgbled_fb *rfb = fb->par;
+	unsigned long flags;
+	ktime_t val;
+
+	spin_lock_irqsave(&rfb->frame_lock, flags);
+	val = rfb->frame_timestamp;
+	spin_unlock_irqrestore(&rfb->frame_lock, flags);
+
+	return sprintf(buf, "%lld\n", ktime_to_ns(val));
+}
+static DEVICE_ATTR_RO(frame_timestamp);
+
+/* gamma curves are exposed as 256 values */
+static ssize_t rgbled_gamma_show(struct rgbled_fb *rfb,
+				 enum rgbled_pixeltype type,
+				 char *buf)
+{
+	ssize_t len = 0;
+	int i;
+
+	spin_lock(&rfb->lock);
+	for (i = 0; i < RGBLED_GAMMA_SIZE; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%u%c",
+				 rfb->gamma[type][i],
+				 ((i & 15) == 15) ? '\n' : ' ');
+	spin_unlock(&rfb->lock);
+
+	return len;
+}
+
+static ssize_t rgbled_gamma_store(struct rgbled_fb *rfb,
+				  enum rgbled_pixeltype type,
+				  const char *buf, size_t count)
+{
+	u8 curve[RGBLED_GAMMA_SIZE];
+	char *str, *tmp, *tok;
+	int i = 0;
+	int err = 0;
+
+	tmp = str = kstrndup(buf, count, GFP_KERNEL);
+	if (!str)
+		return -ENOMEM;
+
+	/* parse exactly RGBLED_GAMMA_SIZE values */
+	while ((tok = strsep(&tmp, " \t\n")) != NULL) {
+		if (!*tok)
+			continue;
+		if (i >= RGBLED_GAMMA_SIZE) {
+			err = -EINVAL;
+			break;
+		}
+		err = kstrtou8(tok, 0, &curve[i++]);
+		if (err)
+			break;
+	}
+	kfree(str);
+	if ((!err) && (i != RGBLED_GAMMA_SIZE))
+		err = -EINVAL;
+	if (err)
+		return err;
+
+	spin_lock(&rfb->lock);
+	memcpy(rfb->gamma[type], curve, sizeof(curve));
+	rfb->gamma_seq++;
+	spin_unlock(&rfb->lock);
+
+	rgbled_damage_all(rfb);
+	rgbled_schedule(rfb->info);
+
+	return count;
+}
+
+#define SYSFS_GAMMA_RW(name, type)					\
+	static ssize_t name ## _show(struct device *dev,		\
+				struct device_attribute *a,		\
+				char *buf)				\
+	{								\
+		struct fb_info *fb = dev_get_drvdata(dev);		\
+									\
+		return rgbled_gamma_show(fb->par, type, buf);		\
+	}								\
+	static ssize_t name ## _store(struct device *dev,		\
+				struct device_attribute *a,		\
+				const char *buf, size_t count)		\
+	{								\
+		struct fb_info *fb = dev_get_drvdata(dev);		\
+									\
+		return rgbled_gamma_store(fb->par, type, buf, count);	\
+	}								\
+	static DEVICE_ATTR_RW(name)
+
+SYSFS_GAMMA_RW(gamma_red, rgbled_pixeltype_red);
+SYSFS_GAMMA_RW(gamma_green, rgbled_pixeltype_green);
+SYSFS_GAMMA_RW(gamma_blue, rgbled_pixeltype_blue);
 
 static struct device_attribute *device_attrs[] = {
 	&dev_attr_brightness,
+	&dev_attr_brightness_effective,
 	&dev_attr_current,
 	&dev_attr_current_max,
 	&dev_attr_current_limit,
@@ -160,6 +350,13 @@ static struct device_attribute *device_attrs[] = {
 	&dev_attr_led_current_base,
 	&dev_attr_led_count,
 	&dev_attr_updates,
+	&dev_attr_dither,
+	&dev_attr_refresh_rate_hz,
+	&dev_attr_frame_count,
+	&dev_attr_frame_timestamp,
+	&dev_attr_gamma_red,
+	&dev_attr_gamma_green,
+	&dev_attr_gamma_blue,
 };
 
 int rgbled_register_sysfs(struct rgbled_fb *rfb)
@@ -184,9 +381,14 @@ int rgbled_register_sysfs(struct rgbled_fb *rfb)
 	if (err) {
 		while (--i >= 0)
 			device_remove_file(fb->dev, device_attrs[i]);
+		return err;
 	}
 
-	return err;
+	/* sysfs_notify may sleep, so look up the node for it only once */
+	rfb->frame_count_kn = sysfs_get_dirent(fb->dev->kobj.sd,
+					       "frame_count");
+
+	return 0;
 }
 
 /* sysled support */
@@ -209,6 +411,9 @@ static void rgbled_brightness_set(struct led_classdev *led_cdev,
 {
 	struct rgbled_led_data *led = container_of(led_cdev,
 						   typeof(*led), cdev);
+
+	rgbled_vmem_write_begin(led->rfb);
+
 	/* set the value itself */
 	switch (led->type) {
 	case rgbled_pixeltype_red:
@@ -241,6 +446,11 @@ static void rgbled_brightness_set(struct led_classdev *led_cdev,
 		break;
 	}
 
+	rgbled_vmem_write_end(led->rfb);
+
+	rgbled_damage_range(led->rfb,
+			    (u8 *)led->pixel - (u8 *)led->rfb->vmem,
+			    sizeof(*led->pixel));
 	rgbled_schedule(led->rfb->info);
 }
 
@@ -273,10 +483,8 @@ static int rgbled_register_single_led(struct rgbled_fb *rfb,
 	struct rgbled_pixel *vpix;
 	int err;
 
-	/* get the pixel */
-	vpix = rgbled_get_raw_pixel(rfb, coord);
-	if (!vpix)
-		return -EINVAL;
+	/* get the pixel - in the first screen of vmem */
+	vpix = &rfb->vmem[coord->y * rfb->width + coord->x];
 
 	/* get a new led instance */
 	led = devres_alloc(rgbled_unregister_single_led,
@@ -365,8 +573,14 @@ int rgbled_register_panel_sysled(struct rgbled_fb *rfb,
 	/* TODO: expose specific leds with custom settings */
 
 	/* expose all leds via led-api if requested */
-	if (rfb->expose_all_led || panel->expose_all_led)
+	if (rfb->expose_all_led || panel->expose_all_led) {
+		if (rfb->bits_per_channel != 8) {
+			fb_err(rfb->info,
+			       "exposing leds needs 8 bits per channel\n");
+			return -EINVAL;
+		}
 		err = rgbled_register_panel_led_all(rfb, panel);
+	}
 
 	return err;
 }
@@ -377,7 +591,7 @@ static struct fb_fix_screeninfo fb_fix_screeninfo_default = {
 	.type		= FB_TYPE_PACKED_PIXELS,
 	.visual		= FB_VISUAL_TRUECOLOR,
 	.xpanstep	= 0,
-	.ypanstep	= 0,
+	.ypanstep	= 1,
 	.ywrapstep	= 0,
 	.accel		= FB_ACCEL_NONE,
 	/* .line_length	= sizeof(ws2812b_pixel) * width */
@@ -406,22 +620,193 @@ static struct fb_var_screeninfo fb_var_screeninfo_default = {
 	.transp		= OFFSETS(brightness),
 };
 
+static struct fb_var_screeninfo fb_var_screeninfo_16 = {
+	.bits_per_pixel  = 8 * sizeof(struct rgbled_pixel16),
+#define OFFSETS16(name) {					\
+		8 * offsetof(struct rgbled_pixel16, name),	\
+		8 * sizeof((((struct rgbled_pixel16 *)0)->name)), \
+		0 }
+	.red		= OFFSETS16(red),
+	.green		= OFFSETS16(green),
+	.blue		= OFFSETS16(blue),
+	.transp		= OFFSETS16(brightness),
+};
+
 static void rgbled_deferred_io(struct fb_info *fb,
 			       struct list_head *pagelist);
 
 static struct fb_deferred_io fb_deferred_io_default = {
-	/* .delay		= HZ / 100, */
+	/* only collects the damage - the frame clock does the pacing
+	 * (fb_deferred_io_init turns a delay of 0 into HZ, so use a jiffy)
+	 */
+	.delay		= 1,
 	.deferred_io	= rgbled_deferred_io,
 };
 
+/* damage tracking */
+
+/* remember when the next frame got requested first
+ * - called with damage_lock held
+ */
+static void rgbled_damage_time(struct rgbled_fb *rfb)
+{
+	if (!ktime_to_ns(rfb->damage_time))
+		rfb->damage_time = ktime_get();
+}
+
+void rgbled_damage_range(struct rgbled_fb *rfb, size_t offset, size_t len)
+{
+	unsigned long flags;
+	size_t start, end;
+
+	spin_lock_irqsave(&rfb->damage_lock, flags);
+
+	/* only the screen shown next matters - a flip damages everything */
+	start = max(offset, rfb->pan_offset);
+	end = min(offset + len, rfb->pan_offset + rfb->vmem_size);
+	if (start < end) {
+		start = (start - rfb->pan_offset) >> PAGE_SHIFT;
+		end = (end - rfb->pan_offset - 1) >> PAGE_SHIFT;
+		bitmap_set(rfb->damage_pages, start, end - start + 1);
+		rgbled_damage_time(rfb);
+	}
+
+	spin_unlock_irqrestore(&rfb->damage_lock, flags);
+}
+
+void rgbled_damage_rect(struct rgbled_fb *rfb, u32 x, u32 y, u32 w, u32 h)
+{
+	u32 height = rfb->height * rfb->buffers;
+	size_t start, end;
+
+	/* clip to the virtual framebuffer */
+	if ((x >= rfb->width) || (y >= height) || (!w) || (!h))
+		return;
+	w = min_t(u32, w, rfb->width - x);
+	h = min_t(u32, h, height - y);
+
+	/* pages typically hold several lines, so just mark the whole band */
+	start = (y * rfb->width + x) * rgbled_pixel_size(rfb);
+	end = ((y + h - 1) * rfb->width + x + w) * rgbled_pixel_size(rfb);
+
+	rgbled_damage_range(rfb, start, end - start);
+}
+
+void rgbled_damage_all(struct rgbled_fb *rfb)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&rfb->damage_lock, flags);
+	rfb->damage_all = true;
+	rgbled_damage_time(rfb);
+	spin_unlock_irqrestore(&rfb->damage_lock, flags);
+}
+
+/* number of attempts to copy a page while kernel writers are active */
+#define RGBLED_SNAPSHOT_RETRIES	4
+
+/* copy a page of the screen into the shadow unless a kernel writer
+ * modified vmem in the meantime - if they keep on interfering, use
+ * what we got and take the page again with the next frame
+ */
+static void rgbled_snapshot_page(struct rgbled_fb *rfb, unsigned long page)
+{
+	size_t offset = page << PAGE_SHIFT;
+	size_t len = min_t(size_t, PAGE_SIZE, rfb->vmem_size - offset);
+	unsigned long flags;
+	int gen, i;
+
+	for (i = 0; i < RGBLED_SNAPSHOT_RETRIES; i++) {
+		gen = atomic_read(&rfb->vmem_gen);
+		smp_rmb();
+		if (atomic_read(&rfb->vmem_writers))
+			continue;
+
+		memcpy((u8 *)rfb->shadow + offset,
+		       (u8 *)rfb->screen + offset, len);
+
+		smp_rmb();
+		if ((!atomic_read(&rfb->vmem_writers)) &&
+		    (atomic_read(&rfb->vmem_gen) == gen))
+			return;
+	}
+
+	spin_lock_irqsave(&rfb->damage_lock, flags);
+	set_bit(page, rfb->damage_pages);
+	spin_unlock_irqrestore(&rfb->damage_lock, flags);
+	rgbled_schedule(rfb->info);
+}
+
+/* translate the damaged pages into dirty panels */
+static bool rgbled_collect_damage(struct rgbled_fb *rfb)
+{
+	struct rgbled_panel_info *panel;
+	int longs = BITS_TO_LONGS(rfb->panel_count);
+	unsigned long flags;
+	unsigned long page;
+	bool dirty = false;
+	bool dither, redraw;
+
+	bitmap_zero(rfb->dirty_panels, rfb->panel_count);
+
+	spin_lock_irqsave(&rfb->damage_lock, flags);
+	/* switch to the screen selected by pan_display */
+	rfb->screen = (struct rgbled_pixel *)((u8 *)rfb->vmem +
+					      rfb->pan_offset);
+	if (rfb->damage_all) {
+		bitmap_fill(rfb->dirty_panels, rfb->panel_count);
+		bitmap_fill(rfb->snapshot_pages, rfb->pages);
+		rfb->damage_all = false;
+	} else {
+		for_each_set_bit(page, rfb->damage_pages, rfb->pages)
+			bitmap_or(rfb->dirty_panels, rfb->dirty_panels,
+				  &rfb->page_panels[page * longs],
+				  rfb->panel_count);
+		bitmap_copy(rfb->snapshot_pages, rfb->damage_pages,
+			    rfb->pages);
+	}
+	bitmap_zero(rfb->damage_pages, rfb->pages);
+	/* the frame about to get rendered carries the damage from now on */
+	rfb->frame_times[(rfb->frame_seq + 1) % RGBLED_FRAME_TIMES].damage =
+		rfb->damage_time;
+	rfb->damage_time = 0;
+	spin_unlock_irqrestore(&rfb->damage_lock, flags);
+
+	/* take the consistent copy of the modified pages */
+	for_each_set_bit(page, rfb->snapshot_pages, rfb->pages)
+		rgbled_snapshot_page(rfb, page);
+
+	/* switching dithering changes the encoding of every panel */
+	dither = READ_ONCE(rfb->dither);
+	redraw = (dither != rfb->dither_active);
+	rfb->dither_active = dither;
+
+	/* and mark the panels - dithering panels need an update as well */
+	list_for_each_entry(panel, &rfb->panels, list) {
+		panel->dirty = redraw ||
+			test_bit(panel->index, rfb->dirty_panels);
+		dirty |= panel->dirty || panel->dithering;
+	}
+
+	return dirty;
+}
+
 /* framebuffer operations */
 
 static ssize_t rgbled_write(struct fb_info *info,
 			    const char __user *buf, size_t count,
 			    loff_t *ppos)
 {
-	ssize_t res = fb_sys_write(info, buf, count, ppos);
+	struct rgbled_fb *rfb = info->par;
+	loff_t pos = *ppos;
+	ssize_t res;
+
+	rgbled_vmem_write_begin(rfb);
+	res = fb_sys_write(info, buf, count, ppos);
+	rgbled_vmem_write_end(rfb);
 
+	if (res > 0)
+		rgbled_damage_range(info->par, pos, res);
 	rgbled_schedule(info);
 
 	return res;
@@ -430,94 +815,164 @@ static ssize_t rgbled_write(struct fb_info *info,
 static void rgbled_fillrect(struct fb_info *info,
 			    const struct fb_fillrect *rect)
 {
+	rgbled_vmem_write_begin(info->par);
 	sys_fillrect(info, rect);
+	rgbled_vmem_write_end(info->par);
+	rgbled_damage_rect(info->par, rect->dx, rect->dy,
+			   rect->width, rect->height);
 	rgbled_schedule(info);
 }
 
 static void rgbled_copyarea(struct fb_info *info,
 			    const struct fb_copyarea *area)
 {
+	rgbled_vmem_write_begin(info->par);
 	sys_copyarea(info, area);
+	rgbled_vmem_write_end(info->par);
+	rgbled_damage_rect(info->par, area->dx, area->dy,
+			   area->width, area->height);
 	rgbled_schedule(info);
 }
 
 static void rgbled_imageblit(struct fb_info *info,
 			     const struct fb_image *image)
 {
+	rgbled_vmem_write_begin(info->par);
 	sys_imageblit(info, image);
+	rgbled_vmem_write_end(info->par);
+	rgbled_damage_rect(info->par, image->dx, image->dy,
+			   image->width, image->height);
 	rgbled_schedule(info);
 }
 
-static struct fb_ops rgbled_ops = {
-	.fb_read	= fb_sys_read,
-	.fb_write	= rgbled_write,
-	.fb_fillrect	= rgbled_fillrect,
-	.fb_copyarea	= rgbled_copyarea,
-	.fb_imageblit	= rgbled_imageblit,
-};
-
-void rgbled_get_pixel_coords_generic(
-	struct rgbled_fb *rfb,
-	struct rgbled_panel_info *panel,
-	int panel_pixel_num,
-	struct rgbled_coordinates *coord)
+void rgbled_frame_done(struct rgbled_fb *rfb, u32 seq)
 {
-	int x, y;
-
-	if (panel->layout_yx) {
-		y = panel_pixel_num % panel->height;
-		x = panel_pixel_num / panel->height;
-
-	} else {
-		x = panel_pixel_num % panel->width;
-		y = panel_pixel_num / panel->width;
+	struct rgbled_frame_times *times;
+	unsigned long flags;
+	ktime_t previous;
+
+	spin_lock_irqsave(&rfb->frame_lock, flags);
+	if ((s32)(seq - rfb->frame_count) <= 0) {
+		spin_unlock_irqrestore(&rfb->frame_lock, flags);
+		return;
 	}
+	previous = rfb->frame_timestamp;
+	rfb->frame_count = seq;
+	rfb->frame_timestamp = ktime_get();
+
+	/* frame_lock makes us the single writer of these stats */
+	times = &rfb->frame_times[seq % RGBLED_FRAME_TIMES];
+	rgbled_stat_stage(&rfb->stats[rgbled_stat_transmit], times->submit);
+	if (ktime_to_ns(times->damage))
+		rgbled_stat_stage(&rfb->stats[rgbled_stat_latency],
+				  times->damage);
+	if (ktime_to_ns(previous))
+		rgbled_stat_add(&rfb->stats[rgbled_stat_interval],
+				ktime_to_ns(ktime_sub(rfb->frame_timestamp,
+						      previous)));
+	spin_unlock_irqrestore(&rfb->frame_lock, flags);
+
+	trace_rgbled_frame_done(rfb, seq);
+
+	/* wake up FBIO_WAITFORVSYNC and poll on frame_count */
+	wake_up_all(&rfb->vsync_wait);
+	if (rfb->frame_count_kn)
+		sysfs_notify_dirent(rfb->frame_count_kn);
+}
+EXPORT_SYMBOL_GPL(rgbled_frame_done);
 
-	if (panel->inverted_x)
-		x = panel->width - 1 - x;
-
-	if (panel->inverted_y)
-		y = panel->height - 1 - y;
+/* wait for the next frame to reach the leds */
+static int rgbled_wait_for_frame(struct rgbled_fb *rfb)
+{
+	u32 count = READ_ONCE(rfb->frame_count);
+	unsigned long flags;
+	ktime_t now, slot;
+	u64 period;
+	bool busy;
+	long ret;
+
+	spin_lock_irqsave(&rfb->frame_lock, flags);
+	period = rgbled_frame_period_ns(rfb);
+	slot = rfb->frame_last;
+	busy = (rfb->frame_scheduled) ||
+		(READ_ONCE(rfb->frame_seq) != rfb->frame_count);
+	spin_unlock_irqrestore(&rfb->frame_lock, flags);
+
+	/* a frame is on its way - so only time out if the output stalls */
+	if (busy) {
+		ret = wait_event_interruptible_timeout(
+			rfb->vsync_wait, READ_ONCE(rfb->frame_count) != count,
+			msecs_to_jiffies(100) + nsecs_to_jiffies(2 * period));
+		if (ret < 0)
+			return ret;
+
+		return ret ? 0 : -ETIMEDOUT;
+	}
 
-	coord->x = x;
-	coord->y = y;
+	/* a static screen sends no frames, so wake up at the next slot of
+	 * the frame clock instead - every 100ms if there is no clock
+	 */
+	if (!period)
+		period = 100 * NSEC_PER_MSEC;
+	now = ktime_get();
+	slot = ktime_add_ns(slot, (div64_u64(ktime_to_ns(ktime_sub(now, slot)),
+					     period) + 1) * period);
+	ret = wait_event_interruptible_hrtimeout(
+		rfb->vsync_wait, READ_ONCE(rfb->frame_count) != count,
+		ktime_sub(slot, now));
+
+	return (ret == -ETIME) ? 0 : ret;
 }
 
-void rgbled_get_pixel_coords_linear(
-	struct rgbled_fb *rfb,
-	struct rgbled_panel_info *panel,
-	int panel_pixel_num,
-	struct rgbled_coordinates *coord)
+static int rgbled_ioctl(struct fb_info *info, unsigned int cmd,
+			unsigned long arg)
 {
-	rgbled_get_pixel_coords_generic(rfb, panel, panel_pixel_num, coord);
-
-	coord->x += panel->x;
-	coord->y += panel->y;
+	struct rgbled_fb *rfb = info->par;
+	u32 crtc;
+
+	switch (cmd) {
+	case FBIO_WAITFORVSYNC:
+		if (get_user(crtc, (u32 __user *)arg))
+			return -EFAULT;
+		if (crtc)
+			return -ENODEV;
+		return rgbled_wait_for_frame(rfb);
+	default:
+		return -ENOTTY;
+	}
 }
-EXPORT_SYMBOL_GPL(rgbled_get_pixel_coords_linear);
 
-void rgbled_get_pixel_coords_meander(
-	struct rgbled_fb *rfb,
-	struct rgbled_panel_info *panel,
-	int panel_pixel_num,
-	struct rgbled_coordinates *coord)
+/* select the screen to render from the next frame on */
+static int rgbled_pan_display(struct fb_var_screeninfo *var,
+			      struct fb_info *info)
 {
-	rgbled_get_pixel_coords_generic(rfb, panel, panel_pixel_num, coord);
+	struct rgbled_fb *rfb = info->par;
+	unsigned long flags;
 
-	/* handle layout */
-	if (panel->layout_yx) {
-		if (coord->x & 1)
-			coord->y = panel->height - 1 - coord->y;
-	} else {
-		if (coord->y & 1)
-			coord->x = panel->width - 1 - coord->x;
-		coord->y += panel->y;
-	}
+	if ((var->xoffset) ||
+	    (var->yoffset + info->var.yres > info->var.yres_virtual))
+		return -EINVAL;
+
+	spin_lock_irqsave(&rfb->damage_lock, flags);
+	rfb->pan_offset = var->yoffset * info->fix.line_length;
+	rfb->damage_all = true;
+	rgbled_damage_time(rfb);
+	spin_unlock_irqrestore(&rfb->damage_lock, flags);
+
+	rgbled_schedule(info);
 
-	coord->x += panel->x;
-	coord->y += panel->y;
+	return 0;
 }
-EXPORT_SYMBOL_GPL(rgbled_get_pixel_coords_meander);
+
+static struct fb_ops rgbled_ops = {
+	.fb_read	= fb_sys_read,
+	.fb_write	= rgbled_write,
+	.fb_fillrect	= rgbled_fillrect,
+	.fb_copyarea	= rgbled_copyarea,
+	.fb_imageblit	= rgbled_imageblit,
+	.fb_ioctl	= rgbled_ioctl,
+	.fb_pan_display	= rgbled_pan_display,
+};
 
 static inline void rgbled_get_pixel_value_set(struct rgbled_fb *rfb,
 					      struct rgbled_panel_info *panel,
@@ -527,10 +982,7 @@ static inline void rgbled_get_pixel_value_set(struct rgbled_fb *rfb,
 	pix->red = r;
 	pix->green = g;
 	pix->blue = b;
-	pix->brightness = (u32)bright *
-		rfb->brightness *
-		panel->brightness /
-		255 / 255;
+	pix->brightness = bright;
 }
 
 static void rgbled_get_pixel_value_default(struct rgbled_fb *rfb,
@@ -555,87 +1007,429 @@ static void rgbled_get_pixel_value_default(struct rgbled_fb *rfb,
 				   vpix->brightness);
 }
 
-static u8 rgbled_handle_panel(struct rgbled_fb *rfb,
-			      int start_pixel,
-			      struct rgbled_panel_info *panel)
+static inline void rgbled_get_pixel_value_mapped(
+	struct rgbled_fb *rfb,
+	struct rgbled_panel_info *panel,
+	u32 offset,
+	struct rgbled_pixel *pix)
+{
+	struct rgbled_pixel *vpix;
+
+	if (offset == RGBLED_PIXEL_MAP_BLACK)
+		return rgbled_get_pixel_value_set(rfb, panel, pix,
+						  0, 0, 0, 0);
+
+	/* copy pixel data */
+	vpix = &rfb->shadow[offset];
+
+	rgbled_get_pixel_value_set(rfb, panel, pix,
+				   vpix->red, vpix->green, vpix->blue,
+				   vpix->brightness);
+}
+
+static inline void rgbled_get_panel_pixel(struct rgbled_fb *rfb,
+					  struct rgbled_panel_info *panel,
+					  bool mapped, int i,
+					  struct rgbled_pixel *pix)
 {
 	struct rgbled_coordinates coord;
-	struct rgbled_pixel pix;
-	int i;
-	u64 c = 0; /* current - need 64bit temporarily because of scaling */
 
-	/* iterate over all pixel */
-	for (i = 0; i < panel->pixel; i++) {
+	if (mapped) {
+		/* the default only needs the precomputed offset */
+		rgbled_get_pixel_value_mapped(rfb, panel,
+					      panel->pixel_map[i], pix);
+	} else {
 		/* get the coordinates */
 		rgbled_get_pixel_coords(rfb, panel, i, &coord);
 		/* now get the corresponding value */
-		rgbled_get_pixel_value(rfb, panel, &coord, &pix);
+		rgbled_get_pixel_value(rfb, panel, &coord, pix);
+	}
+}
 
-		/* here we could add gamma control if needed */
+static inline bool rgbled_panel_is_mapped(struct rgbled_panel_info *panel)
+{
+	return panel->get_pixel_value == rgbled_get_pixel_value_default;
+}
 
-		/* and set it */
-		rfb->set_pixel_value(rfb, panel, start_pixel + i, &pix);
+/* take over modified gamma curves for this update */
+static void rgbled_update_gamma(struct rgbled_fb *rfb)
+{
+	spin_lock(&rfb->lock);
+	if (rfb->gamma_active_seq != rfb->gamma_seq) {
+		memcpy(rfb->gamma_active, rfb->gamma,
+		       sizeof(rfb->gamma_active));
+		rfb->gamma_active_seq = rfb->gamma_seq;
+	}
+	spin_unlock(&rfb->lock);
+}
 
-		/* and calculate current estimate */
-		c += pix.red   * pix.brightness * rfb->led_current_max_red;
-		c += pix.green * pix.brightness * rfb->led_current_max_green;
-		c += pix.blue  * pix.brightness * rfb->led_current_max_blue;
+/* regenerate the gamma table fused with global and panel brightness */
+static void rgbled_update_panel_lut(struct rgbled_fb *rfb,
+				    struct rgbled_panel_info *panel,
+				    u8 brightness)
+{
+	u32 scale = (u32)brightness * panel->brightness;
+	int c, v;
+
+	/* dimming in hardware leaves the full range to the channels */
+	if (rfb->hw_brightness)
+		scale = 255 * 255;
+
+	if ((panel->lut_brightness == brightness) &&
+	    (panel->lut_seq == rfb->gamma_active_seq))
+		return;
+
+	for (c = rgbled_pixeltype_red; c <= rgbled_pixeltype_blue; c++) {
+		for (v = 0; v < RGBLED_GAMMA_SIZE; v++) {
+			panel->lut[c][v] = rfb->gamma_active[c][v] *
+				scale / (255 * 255);
+			panel->lut16[c][v] = (rfb->gamma_active[c][v] << 8) *
+				scale / (255 * 255);
+		}
 	}
-	/* and scale down back */
-	do_div(c, 255 * 255);
 
-	/* add base panel-consumption (after scaling!)*/
-	c += rfb->led_current_base * panel->pixel;
+	panel->lut_brightness = brightness;
+	panel->lut_seq = rfb->gamma_active_seq;
+}
 
-	/* and assign/add it */
-	panel->current_tmp = c;
-	rfb->current_tmp += c;
+/* interpolate a 16 bit value in a lut with RGBLED_GAMMA_SIZE entries */
+static inline u32 rgbled_interpolate16(const u16 *lut, u16 val)
+{
+	int hi = val >> 8;
+	int next = lut[min(hi + 1, RGBLED_GAMMA_SIZE - 1)];
 
-	/* return 255 for a "constant scale" - not rescaling */
-	if (!panel->current_limit)
-		return 255;
-	if (panel->current_limit >= c)
-		return 255;
+	return lut[hi] + (((next - lut[hi]) * (val & 0xff)) >> 8);
+}
 
-	/* so we exceed the limit, so warn */
-	fb_warn(rfb->info,
-		"panel %s consumes %llu mA and exceeded current limit of %i mA\n",
-		panel->name, c, panel->current_limit);
+/* the same for an 8 bit lut returning 8.8 fixed point */
+static inline u32 rgbled_interpolate8(const u8 *lut, u16 val)
+{
+	int hi = val >> 8;
+	int next = lut[min(hi + 1, RGBLED_GAMMA_SIZE - 1)];
 
-	/* and return a different scale */
-	return  (u32)254 * panel->current_limit / (u32)c;
+	return (lut[hi] << 8) + (next - lut[hi]) * (val & 0xff);
 }
 
-static u8 rgbled_handle_panels(struct rgbled_fb *rfb)
+static inline struct rgbled_pixel16 *rgbled_get_raw_pixel16(
+	struct rgbled_fb *rfb, u32 offset)
 {
-	struct rgbled_panel_info *panel;
-	int start_pixel = 0;
-	u8 rescale;
+	return &((struct rgbled_pixel16 *)rfb->shadow)[offset];
+}
 
-	/* reset current estimation */
-	rfb->current_tmp = 0;
+static u64 rgbled_accumulate_chunk16(struct rgbled_fb *rfb,
+				     struct rgbled_chunk *chunk)
+{
+	const u8 (*gamma)[RGBLED_GAMMA_SIZE] = rfb->gamma_active;
+	struct rgbled_panel_info *panel = chunk->panel;
+	struct rgbled_pixel16 *vpix;
+	int i, end = chunk->first + chunk->count;
+	u64 c = 0;
+
+	for (i = chunk->first; i < end; i++) {
+		if (panel->pixel_map[i] == RGBLED_PIXEL_MAP_BLACK)
+			continue;
+		vpix = rgbled_get_raw_pixel16(rfb, panel->pixel_map[i]);
+
+		/* scale 8.8 * 16 bit back to 8 * 8 bit */
+		c += (((u64)rgbled_interpolate8(gamma[rgbled_pixeltype_red],
+						vpix->red) *
+		       vpix->brightness) >> 16) * rfb->led_current_max_red;
+		c += (((u64)rgbled_interpolate8(gamma[rgbled_pixeltype_green],
+						vpix->green) *
+		       vpix->brightness) >> 16) * rfb->led_current_max_green;
+		c += (((u64)rgbled_interpolate8(gamma[rgbled_pixeltype_blue],
+						vpix->blue) *
+		       vpix->brightness) >> 16) * rfb->led_current_max_blue;
+	}
 
-	/* iterate over all panels */
-	list_for_each_entry(panel, &rfb->panels, list) {
-		rescale = rgbled_handle_panel(rfb, start_pixel, panel);
-		/* handle rescale request by propagating */
-		if (rescale != 255)
-			return rescale;
-		start_pixel += panel->pixel;
+	return c;
+}
+
+/* sum up the current drawn by the chunk at full brightness */
+static void rgbled_accumulate_chunk(struct rgbled_fb *rfb,
+				    struct rgbled_chunk *chunk)
+{
+	const u8 (*gamma)[RGBLED_GAMMA_SIZE] = rfb->gamma_active;
+	struct rgbled_panel_info *panel = chunk->panel;
+	struct rgbled_pixel pix;
+	bool mapped = rgbled_panel_is_mapped(panel);
+	int i, end = chunk->first + chunk->count;
+	u64 c = 0; /* current - need 64bit because of scaling */
+
+	if (rfb->bits_per_channel == 16) {
+		chunk->drive = rgbled_accumulate_chunk16(rfb, chunk);
+		return;
+	}
+
+	/* iterate over all pixel */
+	for (i = chunk->first; i < end; i++) {
+		rgbled_get_panel_pixel(rfb, panel, mapped, i, &pix);
+
+		/* with the real drive levels after the transfer curve */
+		c += gamma[rgbled_pixeltype_red][pix.red] *
+			pix.brightness * rfb->led_current_max_red;
+		c += gamma[rgbled_pixeltype_green][pix.green] *
+			pix.brightness * rfb->led_current_max_green;
+		c += gamma[rgbled_pixeltype_blue][pix.blue] *
+			pix.brightness * rfb->led_current_max_blue;
+	}
+
+	/* this is in mA * 255 * 255 and still excludes the base current
+	 * as well as global and panel brightness
+	 */
+	chunk->drive = c;
+}
+
+/* fill the stage with 8.8 fixed point values after gamma/brightness */
+static void rgbled_stage_chunk(struct rgbled_fb *rfb,
+			       struct rgbled_chunk *chunk,
+			       u16 *stage, u8 *alpha)
+{
+	struct rgbled_panel_info *panel = chunk->panel;
+	const u16 (*lut)[RGBLED_GAMMA_SIZE] = panel->lut16;
+	struct rgbled_pixel16 *vpix;
+	struct rgbled_pixel pix;
+	bool mapped = rgbled_panel_is_mapped(panel);
+	int i, j;
+
+	for (j = 0; j < chunk->count; j++, stage += 3) {
+		i = chunk->first + j;
+		if (rfb->bits_per_channel == 8) {
+			rgbled_get_panel_pixel(rfb, panel, mapped, i, &pix);
+			stage[0] = lut[rgbled_pixeltype_red][pix.red];
+			stage[1] = lut[rgbled_pixeltype_green][pix.green];
+			stage[2] = lut[rgbled_pixeltype_blue][pix.blue];
+			alpha[j] = pix.brightness;
+		} else if (panel->pixel_map[i] == RGBLED_PIXEL_MAP_BLACK) {
+			stage[0] = stage[1] = stage[2] = 0;
+			alpha[j] = 0;
+		} else {
+			vpix = rgbled_get_raw_pixel16(rfb,
+						      panel->pixel_map[i]);
+			stage[0] = rgbled_interpolate16(
+				lut[rgbled_pixeltype_red], vpix->red);
+			stage[1] = rgbled_interpolate16(
+				lut[rgbled_pixeltype_green], vpix->green);
+			stage[2] = rgbled_interpolate16(
+				lut[rgbled_pixeltype_blue], vpix->blue);
+			alpha[j] = vpix->brightness >> 8;
+		}
+	}
+}
+
+/* the brightness of a pixel as handed to the driver */
+static inline u8 rgbled_pixel_brightness(struct rgbled_fb *rfb,
+					 struct rgbled_panel_info *panel,
+					 u8 alpha)
+{
+	if (!rfb->hw_brightness)
+		return alpha;
+
+	return (u32)alpha * panel->lut_brightness * panel->brightness /
+		(255 * 255);
+}
+
+/* hand a pixel to the driver - directly or collected for a batch */
+static inline void rgbled_set_chunk_pixel(struct rgbled_fb *rfb,
+					  struct rgbled_chunk *chunk,
+					  int j,
+					  struct rgbled_pixel *pix)
+{
+	struct rgbled_panel_info *panel = chunk->panel;
+
+	if (rfb->set_pixel_values)
+		rfb->batch[chunk->start_pixel + j] = *pix;
+	else
+		rfb->set_pixel_value(rfb, panel,
+				     panel->output_pixel + chunk->first + j,
+				     pix);
+}
+
+/* hand the collected pixel of a chunk to the driver in one go */
+static inline void rgbled_flush_chunk_pixel(struct rgbled_fb *rfb,
+					    struct rgbled_chunk *chunk)
+{
+	struct rgbled_panel_info *panel = chunk->panel;
+
+	if (rfb->set_pixel_values)
+		rfb->set_pixel_values(rfb, panel,
+				      panel->output_pixel + chunk->first,
+				      &rfb->batch[chunk->start_pixel],
+				      chunk->count);
+}
+
+/* encode via the 8.8 fixed point stage - optionally dithered */
+static void rgbled_encode_chunk_staged(struct rgbled_fb *rfb,
+				       struct rgbled_chunk *chunk)
+{
+	u16 *stage = &rfb->stage[chunk->start_pixel * 3];
+	u8 *out = &rfb->stage_out[chunk->start_pixel * 3];
+	u8 *alpha = &rfb->stage_alpha[chunk->start_pixel];
+	int count = chunk->count * 3;
+	struct rgbled_pixel pix;
+	int i;
+
+	rgbled_stage_chunk(rfb, chunk, stage, alpha);
+
+	if (rfb->dither_active) {
+		chunk->dithering = rgbled_dither(
+			stage, &rfb->residual[chunk->start_pixel * 3],
+			out, count);
+	} else {
+		/* just round - the luts stay below 0xff00 */
+		for (i = 0; i < count; i++)
+			out[i] = (stage[i] + 0x80) >> 8;
+		chunk->dithering = false;
+	}
+
+	for (i = 0; i < chunk->count; i++, out += 3) {
+		pix.red = out[0];
+		pix.green = out[1];
+		pix.blue = out[2];
+		pix.brightness = rgbled_pixel_brightness(rfb, chunk->panel,
+							 alpha[i]);
+
+		rgbled_set_chunk_pixel(rfb, chunk, i, &pix);
+	}
+
+	rgbled_flush_chunk_pixel(rfb, chunk);
+}
+
+static void rgbled_encode_chunk(struct rgbled_fb *rfb,
+				struct rgbled_chunk *chunk)
+{
+	struct rgbled_panel_info *panel = chunk->panel;
+	const u8 (*lut)[RGBLED_GAMMA_SIZE] = panel->lut;
+	struct rgbled_pixel pix;
+	bool mapped = rgbled_panel_is_mapped(panel);
+	int j;
+
+	/* finer resolution needs the stage */
+	if ((rfb->dither_active) || (rfb->bits_per_channel != 8))
+		return rgbled_encode_chunk_staged(rfb, chunk);
+	chunk->dithering = false;
+
+	/* iterate over all pixel */
+	for (j = 0; j < chunk->count; j++) {
+		rgbled_get_panel_pixel(rfb, panel, mapped,
+				       chunk->first + j, &pix);
+
+		/* gamma and brightness in a single lookup */
+		pix.red = lut[rgbled_pixeltype_red][pix.red];
+		pix.green = lut[rgbled_pixeltype_green][pix.green];
+		pix.blue = lut[rgbled_pixeltype_blue][pix.blue];
+		pix.brightness = rgbled_pixel_brightness(rfb, panel,
+							 pix.brightness);
+
+		/* and set it */
+		rgbled_set_chunk_pixel(rfb, chunk, j, &pix);
+	}
+
+	rgbled_flush_chunk_pixel(rfb, chunk);
+}
+
+/* the passes of rendering a frame */
+enum rgbled_render_pass {
+	rgbled_render_accumulate,
+	rgbled_render_encode,
+};
+
+/* render chunks of dirty panels until there are none left */
+static void rgbled_render_chunks(struct rgbled_fb *rfb)
+{
+	struct rgbled_chunk *chunk;
+	int i;
+
+	while ((i = atomic_inc_return(&rfb->chunk_next) - 1) <
+	       rfb->chunk_count) {
+		chunk = &rfb->chunks[i];
+		if (!chunk->panel->dirty)
+			continue;
+
+		switch (rfb->render_pass) {
+		case rgbled_render_accumulate:
+			rgbled_accumulate_chunk(rfb, chunk);
+			break;
+		case rgbled_render_encode:
+			rgbled_encode_chunk(rfb, chunk);
+			break;
+		}
 	}
+}
+
+static void rgbled_render_work(struct work_struct *work)
+{
+	struct rgbled_render_worker *worker =
+		container_of(work, struct rgbled_render_worker, work);
+
+	rgbled_render_chunks(worker->rfb);
+}
+
+/* run a pass over all chunks on as many cpus as useful
+ * with the calling worker taking part
+ */
+static void rgbled_render(struct rgbled_fb *rfb, enum rgbled_render_pass pass)
+{
+	int i;
 
-	/* check current */
-	if (!rfb->current_limit)
-		return 255;
-	if (rfb->current_limit >= rfb->current_tmp)
-		return 255;
+	rfb->render_pass = pass;
+	atomic_set(&rfb->chunk_next, 0);
 
-	fb_warn(rfb->info,
-		"total panel consumes %i mA and exceeded current limit of %i mA\n",
-		rfb->current_tmp, rfb->current_limit);
+	for (i = 0; i < rfb->render_worker_count; i++)
+		queue_work(rfb->render_wq, &rfb->render_workers[i].work);
 
-	/* need to return with new scaling */
-	return  (u32)254 * rfb->current_limit / rfb->current_tmp;
+	rgbled_render_chunks(rfb);
+
+	for (i = 0; i < rfb->render_worker_count; i++)
+		flush_work(&rfb->render_workers[i].work);
+}
+
+/* current_drive weighted with the panel brightness */
+static inline u64 rgbled_panel_drive(struct rgbled_panel_info *panel)
+{
+	return panel->current_drive * panel->brightness;
+}
+
+/* the current estimate scales linearly with the brightness */
+static u32 rgbled_panel_current(struct rgbled_fb *rfb,
+				struct rgbled_panel_info *panel,
+				u8 brightness)
+{
+	u64 c = div_u64(rgbled_panel_drive(panel) * brightness,
+			255U * 255 * 255 * 255);
+
+	/* add base panel-consumption (after scaling!)*/
+	return c + rfb->led_current_base * panel->pixel;
+}
+
+/* the highest brightness that keeps the current below limit */
+u8 rgbled_limit_brightness(u8 brightness, u64 drive, u32 base, u32 limit)
+{
+	u64 max;
+
+	if ((!limit) || (!drive))
+		return brightness;
+
+	if (limit <= base)
+		return 0;
+
+	/* solve: base + drive * b / (255 * 255 * 255 * 255) <= limit */
+	max = div64_u64((u64)(limit - base) * 255 * 255 * 255 * 255, drive);
+
+	return min_t(u64, brightness, max);
+}
+EXPORT_SYMBOL_GPL(rgbled_limit_brightness);
+
+static u8 rgbled_limit(struct rgbled_fb *rfb, const char *name,
+		       u8 brightness, u64 drive, u32 base, u32 limit)
+{
+	/* this gets hit on every frame, so do not flood the log */
+	if (limit && drive && (limit <= base))
+		dev_warn_ratelimited(rfb->info->dev,
+				     "%s base current of %u mA exceeds current limit of %u mA\n",
+				     name, base, limit);
+
+	return rgbled_limit_brightness(brightness, drive, base, limit);
 }
 
 static void rgbled_update_stats(struct rgbled_fb *rfb)
@@ -661,40 +1455,183 @@ static void rgbled_update_stats(struct rgbled_fb *rfb)
 
 static void rgbled_deferred_work_default(struct rgbled_fb *rfb)
 {
-	int iterations = 0;
-	u8 rescale = rgbled_handle_panels(rfb);
-
-	/* rescale the global brightness */
-	while (rescale < 255) {
-		/* change brightness */
-		rfb->brightness = rfb->brightness * rescale / 255;
-		/* and rerun the calculation */
-		rescale = rgbled_handle_panels(rfb);
-		/* and exit early after a few loops */
-		iterations++;
-		if (iterations > 256) {
-			fb_warn(rfb->info,
-				"could not reduce brightness enough to reach required current limit - not updating display");
-			return;
-		}
+	struct rgbled_panel_info *panel;
+	struct rgbled_chunk *chunk;
+	u8 previous = rfb->brightness_effective;
+	u8 brightness = rfb->brightness;
+	ktime_t start = ktime_get();
+	u64 drive = 0;
+	u32 base = 0;
+	int i;
+
+	/* nothing to do if no panel got modified */
+	if (!rgbled_collect_damage(rfb)) {
+		WRITE_ONCE(rfb->frames_empty, rfb->frames_empty + 1);
+		return;
+	}
+	start = rgbled_stat_stage(&rfb->stats[rgbled_stat_snapshot], start);
+	trace_rgbled_render_start(rfb, rfb->frame_seq + 1);
+
+	rgbled_update_gamma(rfb);
+
+	/* sum up the currents at full brightness of modified panels
+	 * in parallel and reduce the partial sums per panel
+	 */
+	rgbled_render(rfb, rgbled_render_accumulate);
+	list_for_each_entry(panel, &rfb->panels, list)
+		if (panel->dirty)
+			panel->current_drive = 0;
+	for (i = 0, chunk = rfb->chunks; i < rfb->chunk_count; i++, chunk++)
+		if (chunk->panel->dirty)
+			chunk->panel->current_drive += chunk->drive;
+	start = rgbled_stat_stage(&rfb->stats[rgbled_stat_render], start);
+
+	/* untouched panels keep their previous estimate
+	 * and calculate the brightness possible within the panel limits
+	 */
+	list_for_each_entry(panel, &rfb->panels, list) {
+		drive += rgbled_panel_drive(panel);
+		base += rfb->led_current_base * panel->pixel;
+		brightness = rgbled_limit(
+			rfb, panel->name, brightness,
+			rgbled_panel_drive(panel),
+			rfb->led_current_base * panel->pixel,
+			panel->current_limit);
 	}
 
+	/* and the limit for the whole framebuffer */
+	brightness = rgbled_limit(rfb, "total", brightness,
+				  drive, base, rfb->current_limit);
+	if (brightness < rfb->brightness)
+		WRITE_ONCE(rfb->frames_limited, rfb->frames_limited + 1);
+	start = rgbled_stat_stage(&rfb->stats[rgbled_stat_limit], start);
+
+	/* a changed brightness invalidates all cached encodings
+	 * and dithering panels need to get encoded every time
+	 */
+	rfb->brightness_effective = brightness;
+	list_for_each_entry(panel, &rfb->panels, list) {
+		if ((brightness != previous) || (panel->dithering))
+			panel->dirty = true;
+	}
+
+	/* now encode with the final brightness - again in parallel */
+	list_for_each_entry(panel, &rfb->panels, list)
+		rgbled_update_panel_lut(rfb, panel, brightness);
+	rgbled_render(rfb, rgbled_render_encode);
+
+	/* collect the dithering state and the currents */
+	list_for_each_entry(panel, &rfb->panels, list)
+		if (panel->dirty)
+			panel->dithering = false;
+	for (i = 0, chunk = rfb->chunks; i < rfb->chunk_count; i++, chunk++)
+		if (chunk->panel->dirty && chunk->dithering)
+			chunk->panel->dithering = true;
+
+	rfb->current_tmp = 0;
+	list_for_each_entry(panel, &rfb->panels, list) {
+		panel->current_tmp = rgbled_panel_current(rfb, panel,
+							  brightness);
+		rfb->current_tmp += panel->current_tmp;
+	}
+	trace_rgbled_limit(rfb, rfb->frame_seq + 1);
+
 	/* commit the calculated currents */
 	rgbled_update_stats(rfb);
+	start = rgbled_stat_stage(&rfb->stats[rgbled_stat_encode], start);
 
 	/* and handle the final step */
+	rfb->frame_times[(rfb->frame_seq + 1) % RGBLED_FRAME_TIMES].submit =
+		start;
+	WRITE_ONCE(rfb->frame_seq, rfb->frame_seq + 1);
+	trace_rgbled_render_end(rfb, rfb->frame_seq);
 	if (rfb->finish_work)
 		rfb->finish_work(rfb);
+	rgbled_stat_stage(&rfb->stats[rgbled_stat_submit], start);
+
+	/* keep on updating while dithering */
+	list_for_each_entry(panel, &rfb->panels, list) {
+		if (panel->dithering) {
+			rgbled_schedule(rfb->info);
+			break;
+		}
+	}
 }
 
 static void rgbled_deferred_io(struct fb_info *fb,
 			       struct list_head *pagelist)
 {
 	struct rgbled_fb *rfb = fb->par;
+	struct page *page;
+
+	/* record the pages written via mmap */
+	list_for_each_entry(page, pagelist, lru)
+		rgbled_damage_range(rfb, page->index << PAGE_SHIFT,
+				    PAGE_SIZE);
+
+	/* and render them in the next frame slot */
+	rgbled_schedule(fb);
+}
+
+void rgbled_schedule_frame(struct rgbled_fb *rfb)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&rfb->frame_lock, flags);
+	if ((!rfb->frame_scheduled) && (!rfb->frame_stopped)) {
+		rfb->frame_scheduled = true;
+		hrtimer_start(&rfb->frame_timer, rgbled_next_frame_slot(rfb),
+			      HRTIMER_MODE_ABS);
+		trace_rgbled_frame_schedule(rfb, false);
+	} else if (rfb->frame_scheduled) {
+		/* merged into the frame that is already waiting */
+		WRITE_ONCE(rfb->writes_coalesced, rfb->writes_coalesced + 1);
+		trace_rgbled_frame_schedule(rfb, true);
+	}
+	spin_unlock_irqrestore(&rfb->frame_lock, flags);
+}
+EXPORT_SYMBOL_GPL(rgbled_schedule_frame);
+
+static enum hrtimer_restart rgbled_frame_timer(struct hrtimer *timer)
+{
+	struct rgbled_fb *rfb = container_of(timer, struct rgbled_fb,
+					     frame_timer);
+
+	/* rendering may sleep, so leave it to a worker */
+	queue_work(system_highpri_wq, &rfb->frame_work);
+
+	return HRTIMER_NORESTART;
+}
+
+static void rgbled_frame_work(struct work_struct *work)
+{
+	struct rgbled_fb *rfb = container_of(work, struct rgbled_fb,
+					     frame_work);
+	unsigned long flags;
+
+	/* the slot started when the timer expired (not with the worker)
+	 * and modifications from now on go to the next slot
+	 */
+	spin_lock_irqsave(&rfb->frame_lock, flags);
+	rfb->frame_last = hrtimer_get_expires(&rfb->frame_timer);
+	rfb->frame_scheduled = false;
+	spin_unlock_irqrestore(&rfb->frame_lock, flags);
 
 	rfb->deferred_work(rfb);
 }
 
+static void rgbled_stop_frames(struct rgbled_fb *rfb)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&rfb->frame_lock, flags);
+	rfb->frame_stopped = true;
+	spin_unlock_irqrestore(&rfb->frame_lock, flags);
+
+	hrtimer_cancel(&rfb->frame_timer);
+	cancel_work_sync(&rfb->frame_work);
+}
+
 static inline struct rgbled_panel_info *to_panel_info(
 	struct list_head *list)
 {
@@ -710,6 +1647,12 @@ static int rgbled_panel_info_cmp(void *priv,
 	struct rgbled_panel_info *ad = to_panel_info(a);
 	struct rgbled_panel_info *bd = to_panel_info(b);
 
+	/* group by output first, so each output is a part of the chain */
+	if (ad->output < bd->output)
+		return -1;
+	if (ad->output > bd->output)
+		return 1;
+
 	if (ad->id < bd->id)
 		return -1;
 	if (ad->id > bd->id)
@@ -721,24 +1664,6 @@ static int rgbled_panel_info_cmp(void *priv,
 	return 0;
 }
 
-int rgbled_panel_multiple_width(struct rgbled_panel_info *panel, u32 val)
-{
-	panel->width *= val;
-	panel->pixel *= val;
-
-	return 0;
-}
-EXPORT_SYMBOL_GPL(rgbled_panel_multiple_width);
-
-int rgbled_panel_multiple_height(struct rgbled_panel_info *panel, u32 val)
-{
-	panel->height *= val;
-	panel->pixel *= val;
-
-	return 0;
-}
-EXPORT_SYMBOL_GPL(rgbled_panel_multiple_height);
-
 int rgbled_register_panel(struct rgbled_fb *rfb,
 			  struct rgbled_panel_info *panel)
 {
@@ -759,6 +1684,8 @@ int rgbled_register_panel(struct rgbled_fb *rfb,
 
 	/* add the number of pixel to the chain */
 	rfb->pixel += panel->pixel;
+	if (rfb->outputs < panel->output + 1)
+		rfb->outputs = panel->output + 1;
 
 	/* setting max coordinates for the framebuffer */
 	if (rfb->width < panel->x + panel->width)
@@ -770,14 +1697,91 @@ int rgbled_register_panel(struct rgbled_fb *rfb,
 }
 EXPORT_SYMBOL_GPL(rgbled_register_panel);
 
+u32 rgbled_output_pixel(struct rgbled_fb *rfb, u32 output)
+{
+	struct rgbled_panel_info *panel;
+	u32 pixel = 0;
+
+	list_for_each_entry(panel, &rfb->panels, list)
+		if (panel->output == output)
+			pixel += panel->pixel;
+
+	return pixel;
+}
+EXPORT_SYMBOL_GPL(rgbled_output_pixel);
+
+static void rgbled_devm_vfree(struct device *dev, void *res)
+{
+	vfree(*(void **)res);
+}
+
+void *rgbled_devm_vzalloc(struct device *dev, size_t size)
+{
+	void **ptr;
+
+	ptr = devres_alloc(rgbled_devm_vfree, sizeof(*ptr), GFP_KERNEL);
+	if (!ptr)
+		return NULL;
+
+	*ptr = vzalloc(size);
+	if (!*ptr) {
+		devres_free(ptr);
+		return NULL;
+	}
+
+	devres_add(dev, ptr);
+
+	return *ptr;
+}
+EXPORT_SYMBOL_GPL(rgbled_devm_vzalloc);
+
+/* without a device-tree the panels given are the layout itself
+ * - in chain order, with position, size and output already set
+ */
+static int rgbled_scan_panels_static(struct rgbled_fb *rfb,
+				     struct rgbled_panel_info *panels)
+{
+	struct device *dev = rfb->info->device;
+	struct rgbled_panel_info *panel;
+	int i, err;
+
+	for (i = 0; panels[i].compatible; i++) {
+		panel = devm_kmemdup(dev, &panels[i], sizeof(*panel),
+				     GFP_KERNEL);
+		if (!panel)
+			return -ENOMEM;
+
+		/* same defaults as for the device-tree */
+		panel->id = i;
+		if (!panel->name)
+			panel->name = devm_kasprintf(dev, GFP_KERNEL,
+						     "panel@%i", i);
+		if (!panel->name)
+			return -ENOMEM;
+		if (!panel->brightness)
+			panel->brightness = 255;
+
+		err = rgbled_register_panel(rfb, panel);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
 int rgbled_scan_panels(struct rgbled_fb *rfb,
 		       struct rgbled_panel_info *panels)
 {
 	struct device *dev = rfb->info->device;
+	struct rgbled_panel_info *panel;
+	u32 output = 0, pixel = 0;
 	int err;
 
-	/* scan for panels in device tree */
-	err = rgbled_scan_panels_of(rfb, panels);
+	/* scan for panels in device tree - or take them as given */
+	if (dev->of_node)
+		err = rgbled_scan_panels_of(rfb, panels);
+	else
+		err = rgbled_scan_panels_static(rfb, panels);
 	if (err)
 		return err;
 
@@ -798,16 +1802,52 @@ int rgbled_scan_panels(struct rgbled_fb *rfb,
 		return -EINVAL;
 	}
 
+	/* number the pixel of each panel within its output */
+	list_for_each_entry(panel, &rfb->panels, list) {
+		if (panel->output != output) {
+			output = panel->output;
+			pixel = 0;
+		}
+		panel->output_pixel = pixel;
+		pixel += panel->pixel;
+	}
+
 	return 0;
 }
 
+static void rgbled_free_buffers(struct rgbled_fb *rfb)
+{
+	vfree(rfb->vmem);
+	rfb->vmem = NULL;
+	vfree(rfb->shadow);
+	rfb->shadow = NULL;
+	vfree(rfb->pixel_map);
+	rfb->pixel_map = NULL;
+	vfree(rfb->stage);
+	rfb->stage = NULL;
+	vfree(rfb->batch);
+	rfb->batch = NULL;
+	if (rfb->render_wq)
+		destroy_workqueue(rfb->render_wq);
+	rfb->render_wq = NULL;
+}
+
 static void rgbled_unregister_framebuffer(struct device *dev, void *res)
 {
 	struct rgbled_fb *rfb = *(struct rgbled_fb **)res;
+	struct rgbled_spi_output *out;
 
+	rgbled_unregister_debugfs(rfb);
 	fb_deferred_io_cleanup(rfb->info);
-	vfree(rfb->vmem);
-	rfb->vmem = NULL;
+	rgbled_stop_frames(rfb);
+	/* the outputs get released after us, but their completions
+	 * report to the framebuffer - so wait for them here
+	 */
+	list_for_each_entry(out, &rfb->spi_outputs, list)
+		rgbled_spi_output_stop(out);
+	sysfs_put(rfb->frame_count_kn);
+	rfb->frame_count_kn = NULL;
+	rgbled_free_buffers(rfb);
 	unregister_framebuffer(rfb->info);
 }
 
@@ -826,7 +1866,7 @@ struct rgbled_fb *rgbled_alloc(struct device *dev,
 	struct fb_info *fb;
 	struct rgbled_fb *rfb;
 	struct rgbled_fb **ptr;
-	int err;
+	int err, i;
 
 	/* initialize our own structure */
 	rfb = devm_kzalloc(dev, sizeof(*rfb), GFP_KERNEL);
@@ -839,6 +1879,23 @@ struct rgbled_fb *rgbled_alloc(struct device *dev,
 	/* now set up specific things */
 	INIT_LIST_HEAD(&rfb->panels);
 	spin_lock_init(&rfb->lock);
+	spin_lock_init(&rfb->damage_lock);
+	spin_lock_init(&rfb->frame_lock);
+	hrtimer_init(&rfb->frame_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	rfb->frame_timer.function = rgbled_frame_timer;
+	INIT_WORK(&rfb->frame_work, rgbled_frame_work);
+	init_waitqueue_head(&rfb->vsync_wait);
+	INIT_LIST_HEAD(&rfb->spi_outputs);
+
+	/* linear transfer curves by default */
+	for (i = 0; i < RGBLED_GAMMA_SIZE; i++) {
+		rfb->gamma[rgbled_pixeltype_red][i] = i;
+		rfb->gamma[rgbled_pixeltype_green][i] = i;
+		rfb->gamma[rgbled_pixeltype_blue][i] = i;
+	}
+	rfb->gamma_seq = 1;
+	rfb->bits_per_channel = 8;
+	rfb->buffers = 2;
 
 	/* now allocate the framebuffer_info via devres */
 	ptr = devres_alloc(rgbled_framebuffer_release,
@@ -884,10 +1941,10 @@ static int rgbled_fix_up_structures(struct rgbled_fb *rfb)
 	if (!rfb->deferred_work) {
 		rfb->deferred_work = rgbled_deferred_work_default;
 		/* if there is no custom implementation,
-		 * then we need set_pixel_value
+		 * then we need set_pixel_value(s)
 		 * finish_work is optional...
 		 */
-		if (!rfb->set_pixel_value) {
+		if ((!rfb->set_pixel_value) && (!rfb->set_pixel_values)) {
 			fb_err(rfb->info,
 			       "no set_pixel_value method configured\n");
 			return -EINVAL;
@@ -909,6 +1966,127 @@ static int rgbled_fix_up_structures(struct rgbled_fb *rfb)
 	return 0;
 }
 
+/* precompute the chain to vmem mapping and the damage tracking - only
+ * called once at registration, the panel layout is fixed afterwards, as
+ * the render chunks and stage buffers are sized from it
+ */
+static int rgbled_init_pixel_map(struct rgbled_fb *rfb)
+{
+	struct device *dev = rfb->info->device;
+	struct rgbled_panel_info *panel;
+	struct rgbled_coordinates coord;
+	unsigned long *page_panels;
+	u32 *map;
+	int i, longs, page;
+
+	rfb->pixel_map = vmalloc(rfb->pixel * sizeof(*map));
+	if (!rfb->pixel_map)
+		return -ENOMEM;
+
+	/* number the panels in chain order */
+	rfb->panel_count = 0;
+	list_for_each_entry(panel, &rfb->panels, list)
+		panel->index = rfb->panel_count++;
+	longs = BITS_TO_LONGS(rfb->panel_count);
+
+	/* and allocate the damage tracking structures */
+	rfb->pages = DIV_ROUND_UP(rfb->vmem_size, PAGE_SIZE);
+	rfb->page_panels = devm_kcalloc(dev, rfb->pages * longs,
+					sizeof(long), GFP_KERNEL);
+	rfb->damage_pages = devm_kcalloc(dev, BITS_TO_LONGS(rfb->pages),
+					 sizeof(long), GFP_KERNEL);
+	rfb->snapshot_pages = devm_kcalloc(dev, BITS_TO_LONGS(rfb->pages),
+					   sizeof(long), GFP_KERNEL);
+	rfb->dirty_panels = devm_kcalloc(dev, longs, sizeof(long), GFP_KERNEL);
+	if ((!rfb->page_panels) || (!rfb->damage_pages) ||
+	    (!rfb->snapshot_pages) || (!rfb->dirty_panels))
+		return -ENOMEM;
+
+	/* translate every pixel in chain order to its vmem offset */
+	map = rfb->pixel_map;
+	list_for_each_entry(panel, &rfb->panels, list) {
+		panel->pixel_map = map;
+		for (i = 0; i < panel->pixel; i++, map++) {
+			rgbled_get_pixel_coords(rfb, panel, i, &coord);
+			if ((coord.x < 0) || (coord.x >= rfb->width) ||
+			    (coord.y < 0) || (coord.y >= rfb->height)) {
+				*map = RGBLED_PIXEL_MAP_BLACK;
+				continue;
+			}
+			*map = coord.y * rfb->width + coord.x;
+
+			/* and note that the page is shown on this panel */
+			page = (*map * rgbled_pixel_size(rfb)) >> PAGE_SHIFT;
+			page_panels = &rfb->page_panels[page * longs];
+			set_bit(panel->index, page_panels);
+		}
+	}
+
+	/* the first frame shows everything */
+	rgbled_damage_all(rfb);
+
+	return 0;
+}
+
+/* split the chain into chunks and set up the workers rendering them */
+static int rgbled_init_render(struct rgbled_fb *rfb)
+{
+	struct device *dev = rfb->info->device;
+	struct rgbled_panel_info *panel;
+	struct rgbled_chunk *chunk;
+	u32 first, start_pixel = 0;
+	int i;
+
+	rfb->chunk_count = 0;
+	list_for_each_entry(panel, &rfb->panels, list)
+		rfb->chunk_count += DIV_ROUND_UP(panel->pixel,
+						 RGBLED_CHUNK_PIXEL);
+	rfb->chunks = devm_kcalloc(dev, rfb->chunk_count,
+				   sizeof(*rfb->chunks), GFP_KERNEL);
+	if (!rfb->chunks)
+		return -ENOMEM;
+
+	chunk = rfb->chunks;
+	list_for_each_entry(panel, &rfb->panels, list) {
+		for (first = 0; first < panel->pixel; chunk++) {
+			chunk->panel = panel;
+			chunk->first = first;
+			chunk->count = min_t(u32, panel->pixel - first,
+					     RGBLED_CHUNK_PIXEL);
+			chunk->start_pixel = start_pixel;
+			first += chunk->count;
+			start_pixel += chunk->count;
+		}
+	}
+
+	/* the deferred io worker renders as well, so one less */
+	rfb->render_worker_count = min_t(int, num_online_cpus(),
+					 rfb->chunk_count) - 1;
+	if (rfb->render_worker_count <= 0) {
+		rfb->render_worker_count = 0;
+		return 0;
+	}
+
+	rfb->render_workers = devm_kcalloc(dev, rfb->render_worker_count,
+					   sizeof(*rfb->render_workers),
+					   GFP_KERNEL);
+	if (!rfb->render_workers)
+		return -ENOMEM;
+	for (i = 0; i < rfb->render_worker_count; i++) {
+		rfb->render_workers[i].rfb = rfb;
+		INIT_WORK(&rfb->render_workers[i].work, rgbled_render_work);
+	}
+
+	/* unbound, so that the scheduler spreads them over the cpus */
+	rfb->render_wq = alloc_workqueue("%s-render",
+					 WQ_UNBOUND | WQ_HIGHPRI, 0,
+					 dev_name(dev));
+	if (!rfb->render_wq)
+		return -ENOMEM;
+
+	return 0;
+}
+
 int rgbled_register_panels_sysled(struct rgbled_fb *rfb)
 {
 	struct rgbled_panel_info *panel;
@@ -927,6 +2105,7 @@ int rgbled_register_panels_sysled(struct rgbled_fb *rfb)
 int rgbled_register(struct rgbled_fb *rfb)
 {
 	struct fb_info *fb = rfb->info;
+	struct rgbled_panel_info *panel;
 	int err;
 	struct rgbled_fb **ptr;
 
@@ -940,6 +2119,28 @@ int rgbled_register(struct rgbled_fb *rfb)
 	if (err)
 		return err;
 
+	/* 16 bit per channel is only supported via the pixel map */
+	if (rfb->bits_per_channel == 16) {
+		list_for_each_entry(panel, &rfb->panels, list) {
+			if (!rgbled_panel_is_mapped(panel)) {
+				fb_err(fb,
+				       "panel %s does not support 16 bits per channel\n",
+				       panel->name);
+				return -EINVAL;
+			}
+		}
+		fb->var = fb_var_screeninfo_16;
+	}
+
+	/* set up sizes - with multiple screens for page flipping */
+	fb->var.xres_virtual = rfb->width;
+	fb->var.yres_virtual = rfb->height * rfb->buffers;
+	fb->var.xres = rfb->width;
+	fb->var.yres = rfb->height;
+
+	fb->fix.line_length = rgbled_pixel_size(rfb) * rfb->width;
+	rfb->vmem_size = fb->fix.line_length * rfb->height;
+
 	/* prepare release */
 	ptr = devres_alloc(rgbled_unregister_framebuffer,
 			   sizeof(*ptr), GFP_KERNEL);
@@ -947,25 +2148,56 @@ int rgbled_register(struct rgbled_fb *rfb)
 		return -ENOMEM;
 	*ptr = rfb;
 
-	/* set up sizes */
-	fb->var.xres_virtual = rfb->width;
-	fb->var.yres_virtual = rfb->height;
-	fb->var.xres = rfb->width;
-	fb->var.yres = rfb->height;
+	/* precompute the chain to vmem mapping */
+	err = rgbled_init_pixel_map(rfb);
+	if (err)
+		goto err_free;
 
-	fb->fix.line_length = sizeof(struct rgbled_pixel) * rfb->width;
-	rfb->vmem_size = fb->fix.line_length * rfb->height;
+	/* and the parallel rendering */
+	err = rgbled_init_render(rfb);
+	if (err)
+		goto err_free;
+
+	/* allocate the stage for dithering/16 bit in one go */
+	rfb->stage = vzalloc(rfb->pixel * (3 * sizeof(*rfb->stage) +
+					   3 * sizeof(*rfb->residual) +
+					   3 * sizeof(*rfb->stage_out) +
+					   sizeof(*rfb->stage_alpha)));
+	if (!rfb->stage) {
+		err = -ENOMEM;
+		goto err_free;
+	}
+	rfb->residual = (u8 *)&rfb->stage[3 * rfb->pixel];
+	rfb->stage_out = &rfb->residual[3 * rfb->pixel];
+	rfb->stage_alpha = &rfb->stage_out[3 * rfb->pixel];
+
+	/* the chain order pixel for batched encoding */
+	if (rfb->set_pixel_values) {
+		rfb->batch = vzalloc(rfb->pixel * sizeof(*rfb->batch));
+		if (!rfb->batch) {
+			err = -ENOMEM;
+			goto err_free;
+		}
+	}
 
 	/* allocate memory */
-	rfb->vmem = vzalloc(rfb->vmem_size);
+	rfb->vmem = vzalloc(rfb->vmem_size * rfb->buffers);
 	if (!rfb->vmem) {
-		devres_free(ptr);
-		return -ENOMEM;
+		err = -ENOMEM;
+		goto err_free;
+	}
+	rfb->screen = rfb->vmem;
+
+	/* and the copy the frames get rendered from */
+	rfb->shadow = vzalloc(rfb->vmem_size);
+	if (!rfb->shadow) {
+		err = -ENOMEM;
+		goto err_free;
 	}
 
 	/* set vmem data */
-	fb->fix.smem_len = rfb->vmem_size;
-	fb->screen_size = rfb->vmem_size;
+	fb->fix.smem_len = rfb->vmem_size * rfb->buffers;
+	fb->screen_size = fb->fix.smem_len;
 
 	fb->screen_base = (typeof(fb->screen_base))rfb->vmem;
 	fb->fix.smem_start = (typeof(fb->fix.smem_start))rfb->vmem;
@@ -975,11 +2207,8 @@ int rgbled_register(struct rgbled_fb *rfb)
 
 	/* register fb */
 	err = register_framebuffer(fb);
-	if (err) {
-		vfree(rfb->vmem);
-		devres_free(ptr);
-		return err;
-	}
+	if (err)
+		goto err_free;
 	/* now register resource cleanup */
 	devres_add(fb->device, ptr);
 
@@ -993,18 +2222,22 @@ int rgbled_register(struct rgbled_fb *rfb)
 	if (err)
 		return err;
 
-	/* calculate refresh rate to use */
-	if (!rfb->deferred_io.delay)
-		rfb->deferred_io.delay = HZ / 100;
+	/* and the frame statistics */
+	rgbled_register_debugfs(rfb);
 
 	/* and start an initial update of the framebuffer to clean it */
-	rfb->deferred_work(rfb);
+	rgbled_schedule_frame(rfb);
 
 	/* and report the status */
-	fb_info(fb, "%s of size %ux%u with %i led, max refresh %luHz\n",
+	fb_info(fb, "%s of size %ux%u with %i led, frame time %lluus\n",
 		fb->fix.id, rfb->width, rfb->height, rfb->pixel,
-		HZ / rfb->deferred_io.delay);
+		div_u64(rfb->frame_wire_ns, NSEC_PER_USEC));
 	return 0;
+
+err_free:
+	rgbled_free_buffers(rfb);
+	devres_free(ptr);
+	return err;
 }
 EXPORT_SYMBOL_GPL(rgbled_register);
 
@@ -0,0 +1,120 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  decoder for 3 times oversampled one-wire (ws2812) bitstreams
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifdef __KERNEL__
+#include <linux/kernel.h>
+#include <linux/module.h>
+#else
+#define EXPORT_SYMBOL_GPL(sym)
+#endif
+
+#include "rgbled-fb-decode.h"
+
+static inline u32 rgbled_ws2812_bit(const u8 *data, size_t pos)
+{
+	return (data[pos >> 3] >> (7 - (pos & 7))) & 1;
+}
+
+static inline void rgbled_ws2812_emit(
+	void (*emit)(void *context, const struct rgbled_ws2812_token *tok),
+	void *context, enum rgbled_ws2812_token_type type,
+	size_t bit, u32 value)
+{
+	struct rgbled_ws2812_token tok = {
+		.type = type,
+		.bit = bit,
+		.value = value,
+	};
+
+	emit(context, &tok);
+}
+
+/* every bit is sent as a 3 bit symbol: 0b100 for 0 and 0b110 for 1,
+ * so the line is low for at most 2 bits in a valid stream - anything
+ * longer is either a gap or a latch
+ */
+void rgbled_ws2812_decode(const u8 *data, size_t len, u32 latch_bits,
+			  void (*emit)(void *context,
+				       const struct rgbled_ws2812_token *tok),
+			  void *context)
+{
+	size_t bits = len * 8;
+	size_t pos = 0, start, led_start = 0;
+	u32 led = 0, led_bits = 0;
+	u32 low, sym;
+
+	while (pos < bits) {
+		/* the low period up to the next symbol */
+		start = pos;
+		while ((pos < bits) && (!rgbled_ws2812_bit(data, pos)))
+			pos++;
+		low = pos - start;
+
+		/* a latch (or the end) terminates the chain */
+		if ((low >= latch_bits) || (pos == bits)) {
+			if (led_bits)
+				rgbled_ws2812_emit(emit, context,
+						   rgbled_ws2812_token_partial,
+						   led_start, led_bits);
+			led = 0;
+			led_bits = 0;
+			if (low)
+				rgbled_ws2812_emit(emit, context,
+						   low >= latch_bits ?
+						   rgbled_ws2812_token_latch :
+						   rgbled_ws2812_token_gap,
+						   start, low);
+			continue;
+		}
+		if (low)
+			rgbled_ws2812_emit(emit, context,
+					   rgbled_ws2812_token_gap, start, low);
+
+		/* the symbol - a truncated one is filled with low bits */
+		sym = rgbled_ws2812_bit(data, pos) << 2;
+		if (pos + 1 < bits)
+			sym |= rgbled_ws2812_bit(data, pos + 1) << 1;
+		if (pos + 2 < bits)
+			sym |= rgbled_ws2812_bit(data, pos + 2);
+		if ((sym != 0x4) && (sym != 0x6))
+			rgbled_ws2812_emit(emit, context,
+					   rgbled_ws2812_token_symbol,
+					   pos, sym);
+
+		/* the level in the middle of the symbol is what counts */
+		if (!led_bits)
+			led_start = pos;
+		led = (led << 1) | ((sym >> 1) & 1);
+		led_bits++;
+		pos += 3;
+
+		if (led_bits == 24) {
+			rgbled_ws2812_emit(emit, context,
+					   rgbled_ws2812_token_led,
+					   led_start, led);
+			led = 0;
+			led_bits = 0;
+		}
+	}
+
+	if (led_bits)
+		rgbled_ws2812_emit(emit, context, rgbled_ws2812_token_partial,
+				   led_start, led_bits);
+}
+EXPORT_SYMBOL_GPL(rgbled_ws2812_decode);
@@ -0,0 +1,81 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb-decode.h
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  decoder for 3 times oversampled one-wire (ws2812) bitstreams
+ *
+ *  This does not depend on anything but these types, so it can get
+ *  compiled into userspace tools as well (without __KERNEL__).
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef __RGBLED_FB_DECODE_H
+#define __RGBLED_FB_DECODE_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint32_t u32;
+#endif
+
+/* the low time that latches the data: 50us (280us for newer ws2812b) */
+#define RGBLED_WS2812_LATCH_NS	50000
+
+/**
+ * enum rgbled_ws2812_token_type - the things found in the bitstream
+ * @rgbled_ws2812_token_led: 24 valid bits - value is 0xGGRRBB
+ * @rgbled_ws2812_token_latch: low for at least the latch time
+ *                             - value is the number of low bits
+ * @rgbled_ws2812_token_gap: low longer than within a symbol, but not
+ *                           long enough to latch (also when the stream
+ *                           ends without a proper latch)
+ *                           - value is the number of low bits
+ * @rgbled_ws2812_token_symbol: a symbol other than 0b100 or 0b110
+ *                              - value is the 3 bit symbol (decoded by
+ *                              its middle bit)
+ * @rgbled_ws2812_token_partial: a led cut short by a latch or the end
+ *                               - value is the number of bits received
+ */
+enum rgbled_ws2812_token_type {
+	rgbled_ws2812_token_led,
+	rgbled_ws2812_token_latch,
+	rgbled_ws2812_token_gap,
+	rgbled_ws2812_token_symbol,
+	rgbled_ws2812_token_partial,
+};
+
+/**
+ * struct rgbled_ws2812_token - a decoded token
+ * @type: the type of token
+ * @bit: the position in the bitstream (in spi bits)
+ * @value: depending on @type
+ */
+struct rgbled_ws2812_token {
+	enum rgbled_ws2812_token_type type;
+	size_t			bit;
+	u32			value;
+};
+
+/* decode len bytes of spi data (msb first) - calling emit for every
+ * token in stream order. latch_bits is the number of low spi bits
+ * that latch the data (RGBLED_WS2812_LATCH_NS at the spi speed)
+ */
+void rgbled_ws2812_decode(const u8 *data, size_t len, u32 latch_bits,
+			  void (*emit)(void *context,
+				       const struct rgbled_ws2812_token *tok),
+			  void *context);
+
+#endif /* __RGBLED_FB_DECODE_H */
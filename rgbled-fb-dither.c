@@ -0,0 +1,87 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  temporal dithering
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <asm/unaligned.h>
+
+#include "rgbled-fb.h"
+
+/* masks for four 16 bit lanes in a 64 bit word */
+#define LANES_LOW_BYTE	0x00ff00ff00ff00ffULL
+#define LANES_LOW_HALF	0x0000ffff0000ffffULL
+
+/* spread 4 bytes into the low bytes of four 16 bit lanes */
+static inline u64 rgbled_unpack_lanes(u32 val)
+{
+	u64 x = val;
+
+	x = (x | (x << 16)) & LANES_LOW_HALF;
+	x = (x | (x << 8)) & LANES_LOW_BYTE;
+
+	return x;
+}
+
+/* and collect the low bytes of four 16 bit lanes again */
+static inline u32 rgbled_pack_lanes(u64 x)
+{
+	x &= LANES_LOW_BYTE;
+	x = (x | (x >> 8)) & LANES_LOW_HALF;
+	x = (x | (x >> 16));
+
+	return (u32)x;
+}
+
+/*
+ * the part of an 8.8 fixed point value that can not get shown in this
+ * frame is carried over in @residual and gets added in the next frame,
+ * so that over time the led shows the exact average
+ *
+ * works on four channels per 64 bit word, which does not overflow
+ * as long as the values stay below 0xff00 (which the luts ensure)
+ *
+ * returns true if any value has a fraction - so needs further frames
+ */
+bool rgbled_dither(const u16 *in, u8 *residual, u8 *out, int count)
+{
+	u64 frac = 0;
+	u64 sum;
+	int i;
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		sum = get_unaligned((const u64 *)&in[i]);
+		frac |= sum;
+		sum += rgbled_unpack_lanes(
+			get_unaligned((const u32 *)&residual[i]));
+
+		put_unaligned(rgbled_pack_lanes(sum >> 8), (u32 *)&out[i]);
+		put_unaligned(rgbled_pack_lanes(sum), (u32 *)&residual[i]);
+	}
+
+	/* and the remaining channels */
+	for (; i < count; i++) {
+		sum = in[i] + residual[i];
+		frac |= in[i];
+
+		out[i] = sum >> 8;
+		residual[i] = sum & 0xff;
+	}
+
+	return frac & LANES_LOW_BYTE;
+}
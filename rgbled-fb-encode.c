@@ -0,0 +1,133 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  the pixel encoding of the ws2812 and apa102 chips
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+
+#include "rgbled-fb.h"
+
+/* every bit b of a byte becomes 0b1b0 - bit 7 ending up on top */
+#define RGBLED_3BIT(v, b)	((0x4 | ((((v) >> (b)) & 1) << 1)) << (3 * (b)))
+#define RGBLED_3BIT_BYTE(v)						\
+	(RGBLED_3BIT(v, 7) | RGBLED_3BIT(v, 6) | RGBLED_3BIT(v, 5) |	\
+	 RGBLED_3BIT(v, 4) | RGBLED_3BIT(v, 3) | RGBLED_3BIT(v, 2) |	\
+	 RGBLED_3BIT(v, 1) | RGBLED_3BIT(v, 0))
+
+/* sent as high, medium, low */
+#define E1(v)	{ (RGBLED_3BIT_BYTE(v) >> 16) & 0xff,	\
+		  (RGBLED_3BIT_BYTE(v) >> 8) & 0xff,	\
+		  RGBLED_3BIT_BYTE(v) & 0xff }
+#define E4(v)	E1(v), E1((v) + 1), E1((v) + 2), E1((v) + 3)
+#define E16(v)	E4(v), E4((v) + 4), E4((v) + 8), E4((v) + 12)
+#define E64(v)	E16(v), E16((v) + 16), E16((v) + 32), E16((v) + 48)
+
+/* the complete encoding of each byte value - generated at compile time,
+ * so it is read-only and shared by all devices encoding concurrently
+ */
+const u8 rgbled_encode_3bit_table[256][3] = {
+	E64(0), E64(64), E64(128), E64(192)
+};
+EXPORT_SYMBOL_GPL(rgbled_encode_3bit_table);
+
+void rgbled_encode_3bit(u8 *dst, const u8 *src, int count)
+{
+	int i;
+
+	/* the bulk vectorized if possible and the rest via table */
+	i = rgbled_encode_3bit_simd(dst, src, count);
+	for (dst += 3 * i; i < count; i++, dst += 3)
+		memcpy(dst, rgbled_encode_3bit_table[src[i]], 3);
+}
+EXPORT_SYMBOL_GPL(rgbled_encode_3bit);
+
+/* val * brightness / 255 without division (exact for all 8 bit values) */
+static inline u8 rgbled_scale(u8 val, u8 brightness)
+{
+	u32 t = val * brightness;
+
+	return (t + 1 + (t >> 8)) >> 8;
+}
+
+void rgbled_encode_ws2812(struct ws2812b_pixel *dst, u8 *grb,
+			  const struct rgbled_pixel *pix, int count)
+{
+	u8 *p = grb;
+	int i;
+
+	/* the channel values in transmission order
+	 * global and panel brightness are already applied by the core
+	 * so this only scales pixel dimmed via their own alpha
+	 */
+	for (i = 0; i < count; i++, pix++, p += 3) {
+		if (pix->brightness == 255) {
+			p[0] = pix->green;
+			p[1] = pix->red;
+			p[2] = pix->blue;
+		} else {
+			p[0] = rgbled_scale(pix->green, pix->brightness);
+			p[1] = rgbled_scale(pix->red, pix->brightness);
+			p[2] = rgbled_scale(pix->blue, pix->brightness);
+		}
+	}
+
+	/* and encode them in one go */
+	rgbled_encode_3bit((u8 *)dst, grb, count * 3);
+}
+EXPORT_SYMBOL_GPL(rgbled_encode_ws2812);
+
+void rgbled_apa102_frame_init(void *frame, u32 pixel)
+{
+	struct apa102_pixel *data = frame;
+	u32 i;
+
+	/* the start frame */
+	memset(data, 0, sizeof(*data));
+	/* the leds - off */
+	for (i = 1; i <= pixel; i++)
+		data[i] = (struct apa102_pixel) { .brightness = 0xe0 };
+	/* and the trailing clocks - 1 per led */
+	memset(&data[pixel + 1], 0xff, pixel / 8 + 1);
+}
+EXPORT_SYMBOL_GPL(rgbled_apa102_frame_init);
+
+void rgbled_encode_apa102(struct apa102_pixel *dst,
+			  const struct rgbled_pixel *pix, int count)
+{
+	u32 level, scale;
+	int i;
+
+	/* the 5 bit current level of the led does the dimming and the
+	 * channels make up for its coarse steps, so they keep their
+	 * resolution even at low brightness
+	 */
+	for (i = 0; i < count; i++, pix++, dst++) {
+		level = DIV_ROUND_UP(pix->brightness * 31, 255);
+		scale = pix->brightness * 31;
+
+		dst->brightness = 0xe0 | level;
+		if (!level) {
+			dst->r = dst->g = dst->b = 0;
+			continue;
+		}
+		dst->r = DIV_ROUND_CLOSEST(pix->red * scale, level * 255);
+		dst->g = DIV_ROUND_CLOSEST(pix->green * scale, level * 255);
+		dst->b = DIV_ROUND_CLOSEST(pix->blue * scale, level * 255);
+	}
+}
+EXPORT_SYMBOL_GPL(rgbled_encode_apa102);
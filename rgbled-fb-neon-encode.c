@@ -0,0 +1,72 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  neon kernel for the 3 times oversampled one-wire encoding
+ *
+ *  This file gets compiled with the vector unit enabled,
+ *  so it must only get called between kernel_neon_begin/end
+ *  (see rgbled-fb-neon.c) and can not include any kernel headers.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <arm_neon.h>
+
+void rgbled_encode_3bit_neon(unsigned char *dst, const unsigned char *src,
+			     int blocks);
+
+/* every bit b of a byte becomes 0b1b0, so bits 7..0 end up as:
+ *   high:   1 b7 0 1 b6 0 1 b5
+ *   medium: 0 1 b4 0 1 b3 0 1
+ *   low:    b2 0 1 b1 0 1 b0 0
+ * 16 bytes get spread per iteration and written interleaved as
+ * high, medium, low - exactly the same as the scalar tables
+ */
+void rgbled_encode_3bit_neon(unsigned char *dst, const unsigned char *src,
+			     int blocks)
+{
+	const uint8x16_t bit0 = vdupq_n_u8(0x01);
+	const uint8x16_t bit1 = vdupq_n_u8(0x02);
+	const uint8x16_t bit2 = vdupq_n_u8(0x04);
+	const uint8x16_t bit3 = vdupq_n_u8(0x08);
+	const uint8x16_t bit4 = vdupq_n_u8(0x10);
+	const uint8x16_t bit5 = vdupq_n_u8(0x20);
+	const uint8x16_t bit6 = vdupq_n_u8(0x40);
+	const uint8x16_t bit7 = vdupq_n_u8(0x80);
+	uint8x16x3_t enc;
+	uint8x16_t v;
+
+	for (; blocks > 0; blocks--, src += 16, dst += 48) {
+		v = vld1q_u8(src);
+
+		enc.val[0] = vorrq_u8(
+			vorrq_u8(vdupq_n_u8(0x92),
+				 vandq_u8(vshrq_n_u8(v, 1), bit6)),
+			vorrq_u8(vandq_u8(vshrq_n_u8(v, 3), bit3),
+				 vandq_u8(vshrq_n_u8(v, 5), bit0)));
+
+		enc.val[1] = vorrq_u8(
+			vdupq_n_u8(0x49),
+			vorrq_u8(vandq_u8(vshlq_n_u8(v, 1), bit5),
+				 vandq_u8(vshrq_n_u8(v, 1), bit2)));
+
+		enc.val[2] = vorrq_u8(
+			vorrq_u8(vdupq_n_u8(0x24),
+				 vandq_u8(vshlq_n_u8(v, 5), bit7)),
+			vorrq_u8(vandq_u8(vshlq_n_u8(v, 3), bit4),
+				 vandq_u8(vshlq_n_u8(v, 1), bit1)));
+
+		vst3q_u8(dst, enc);
+	}
+}
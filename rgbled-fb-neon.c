@@ -0,0 +1,46 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  neon glue for the vectorized encoders
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <asm/neon.h>
+
+#include "rgbled-fb.h"
+
+/* below this the cost of saving the neon state is not worth it */
+#define RGBLED_NEON_MIN_BLOCKS 4
+
+/* in rgbled-fb-neon-encode.c */
+void rgbled_encode_3bit_neon(unsigned char *dst, const unsigned char *src,
+			     int blocks);
+
+int rgbled_encode_3bit_simd(u8 *dst, const u8 *src, int count)
+{
+	int blocks = count / 16;
+
+	if (blocks < RGBLED_NEON_MIN_BLOCKS)
+		return 0;
+
+	kernel_neon_begin();
+	rgbled_encode_3bit_neon(dst, src, blocks);
+	kernel_neon_end();
+
+	return blocks * 16;
+}
+EXPORT_SYMBOL_GPL(rgbled_encode_3bit_simd);
@@ -53,6 +53,9 @@ static int rgbled_probe_of_panel(struct rgbled_fb *rfb,
 	if (of_property_read_u32_index(nc, "reg",    0, &panel->id))
 		return -EINVAL;
 
+	/* the output the panel is chained on */
+	of_property_read_u32_index(nc, "output", 0, &panel->output);
+
 	/* basic layout stuff */
 	of_property_read_u32_index(nc, "x",      0, &panel->x);
 	of_property_read_u32_index(nc, "y",      0, &panel->y);
@@ -188,16 +191,54 @@ int rgbled_scan_panels_of(struct rgbled_fb *rfb,
 	return 0;
 }
 
+static int rgbled_register_gamma_of(struct rgbled_fb *rfb,
+				    struct device_node *nc)
+{
+	static const char * const props[] = {
+		[rgbled_pixeltype_red]		= "gamma-red",
+		[rgbled_pixeltype_green]	= "gamma-green",
+		[rgbled_pixeltype_blue]		= "gamma-blue",
+	};
+	int i;
+
+	/* a common curve for all channels */
+	if (of_find_property(nc, "gamma", NULL)) {
+		for (i = 0; i < ARRAY_SIZE(props); i++)
+			if (of_property_read_u8_array(nc, "gamma",
+						      rfb->gamma[i],
+						      RGBLED_GAMMA_SIZE))
+				goto parse_error;
+	}
+
+	/* and per channel overrides */
+	for (i = 0; i < ARRAY_SIZE(props); i++) {
+		if (!of_find_property(nc, props[i], NULL))
+			continue;
+		if (of_property_read_u8_array(nc, props[i], rfb->gamma[i],
+					      RGBLED_GAMMA_SIZE))
+			goto parse_error;
+	}
+
+	return 0;
+
+parse_error:
+	fb_err(rfb->info,
+	       "gamma curves need %i byte values in %s\n",
+	       RGBLED_GAMMA_SIZE, nc->name);
+	return -EINVAL;
+}
+
 int rgbled_register_of(struct rgbled_fb *rfb)
 {
 	struct fb_info *fb = rfb->info;
 	struct device_node *nc = fb->device->of_node;
 	u32 tmp;
+	int err;
 
-	/* some basics */
+	/* some basics - all properties are optional without a device-tree */
 	rfb->of_node = nc;
 	if (!rfb->name)
-		rfb->name = nc->kobj.name;
+		rfb->name = nc ? nc->kobj.name : dev_name(fb->device);
 
 	/* read brightness and current limits from device-tree */
 	of_property_read_u32_index(nc, "current-limit",
@@ -220,6 +261,30 @@ int rgbled_register_of(struct rgbled_fb *rfb)
 	if (of_find_property(nc, "linux,expose-all-led", NULL))
 		rfb->expose_all_led = true;
 
+	/* higher resolution */
+	of_property_read_u32_index(nc, "bits-per-channel",
+				   0, &rfb->bits_per_channel);
+	if ((rfb->bits_per_channel != 8) && (rfb->bits_per_channel != 16)) {
+		fb_err(fb, "unsupported bits-per-channel %u\n",
+		       rfb->bits_per_channel);
+		return -EINVAL;
+	}
+	if (of_find_property(nc, "dither", NULL))
+		rfb->dither = true;
+
+	/* screens for page flipping */
+	of_property_read_u32_index(nc, "buffers", 0, &rfb->buffers);
+	if ((rfb->buffers < 1) || (rfb->buffers > RGBLED_MAX_BUFFERS)) {
+		fb_err(fb, "unsupported number of buffers %u\n",
+		       rfb->buffers);
+		return -EINVAL;
+	}
+
+	/* the transfer curves */
+	err = rgbled_register_gamma_of(rfb, nc);
+	if (err)
+		return err;
+
 	return 0;
 }
 
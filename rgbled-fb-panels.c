@@ -0,0 +1,279 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  panel geometry and the panel types of the drivers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+
+#include "rgbled-fb.h"
+
+static void rgbled_get_pixel_coords_generic(
+	struct rgbled_fb *rfb,
+	struct rgbled_panel_info *panel,
+	int panel_pixel_num,
+	struct rgbled_coordinates *coord)
+{
+	int x, y;
+
+	if (panel->layout_yx) {
+		y = panel_pixel_num % panel->height;
+		x = panel_pixel_num / panel->height;
+
+	} else {
+		x = panel_pixel_num % panel->width;
+		y = panel_pixel_num / panel->width;
+	}
+
+	if (panel->inverted_x)
+		x = panel->width - 1 - x;
+
+	if (panel->inverted_y)
+		y = panel->height - 1 - y;
+
+	coord->x = x;
+	coord->y = y;
+}
+
+void rgbled_get_pixel_coords_linear(
+	struct rgbled_fb *rfb,
+	struct rgbled_panel_info *panel,
+	int panel_pixel_num,
+	struct rgbled_coordinates *coord)
+{
+	rgbled_get_pixel_coords_generic(rfb, panel, panel_pixel_num, coord);
+
+	coord->x += panel->x;
+	coord->y += panel->y;
+}
+EXPORT_SYMBOL_GPL(rgbled_get_pixel_coords_linear);
+
+void rgbled_get_pixel_coords_meander(
+	struct rgbled_fb *rfb,
+	struct rgbled_panel_info *panel,
+	int panel_pixel_num,
+	struct rgbled_coordinates *coord)
+{
+	rgbled_get_pixel_coords_generic(rfb, panel, panel_pixel_num, coord);
+
+	/* handle layout */
+	if (panel->layout_yx) {
+		if (coord->x & 1)
+			coord->y = panel->height - 1 - coord->y;
+	} else {
+		if (coord->y & 1)
+			coord->x = panel->width - 1 - coord->x;
+	}
+
+	coord->x += panel->x;
+	coord->y += panel->y;
+}
+EXPORT_SYMBOL_GPL(rgbled_get_pixel_coords_meander);
+
+int rgbled_panel_multiple_width(struct rgbled_panel_info *panel, u32 val)
+{
+	panel->width *= val;
+	panel->pixel *= val;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(rgbled_panel_multiple_width);
+
+int rgbled_panel_multiple_height(struct rgbled_panel_info *panel, u32 val)
+{
+	panel->height *= val;
+	panel->pixel *= val;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(rgbled_panel_multiple_height);
+
+/* the panel types of the ws2812b chip */
+struct rgbled_panel_info ws2812b_panels[] = {
+	{
+		.compatible		= "worldsemi,ws2812b,strip",
+		.width			= 1,
+		.height			= 1,
+		.flags			= RGBLED_FLAG_CHANGE_WHLP,
+	},
+	{
+		.compatible		= "adafruit,neopixel,strip,30",
+		.width			= 1,
+		.height			= 1,
+		.pitch			= 30,
+		.flags			= RGBLED_FLAG_CHANGE_WHL,
+	},
+	{
+		.compatible		= "adafruit,neopixel,strip,60",
+		.width			= 1,
+		.height			= 1,
+		.pitch			= 60,
+		.flags			= RGBLED_FLAG_CHANGE_WHL,
+	},
+	{
+		.compatible		= "adafruit,neopixel,strip,144",
+		.width			= 1,
+		.height			= 1,
+		.pitch			= 144,
+		.flags			= RGBLED_FLAG_CHANGE_WHL,
+	},
+#ifdef VERIFIED_SETTINGS
+	{
+		.compatible		= "adafruit,neopixel,ring,12",
+		.pixel			= 12,
+		.width			= 6,
+		.height			= 6,
+/*
+		.get_pixel_coords	= ws2812b_get_pixel_coordinates_ring12,
+		.pitch			= 112,
+*/
+
+	},
+	{
+		.compatible		= "adafruit,neopixel,ring,16",
+		.pixel			= 16,
+		.width			= 8,
+		.height			= 8,
+/*
+		.get_pixel_coords	= ws2812b_get_pixel_coordinates_ring16,
+		.pitch			= 112,
+*/
+	},
+	{
+		.compatible		= "adafruit,neopixel,ring,24",
+		.pixel			= 24,
+		.width			= 10,
+		.height			= 10,
+/*
+		.get_pixel_coords	= ws2812b_get_pixel_coordinates_ring24,
+		.pitch			= 112,
+*/
+	},
+	{
+		.compatible		= "adafruit,neopixel,arc,15",
+		.pixel			= 15,
+		.width			= 8,
+		.height			= 8,
+/*
+		.get_pixel_coords	= ws2812b_get_pixel_coordinates_arc15,
+		.pitch		= 112,
+*/
+	},
+#endif
+	{
+		.compatible		= "adafruit,neopixel,matrix,8x8",
+		.width			= 8,
+		.height			= 8,
+		.get_pixel_coords	= rgbled_get_pixel_coords_meander,
+		.pitch			= 112,
+		.multiple		= rgbled_panel_multiple_height,
+	},
+	{
+		.compatible		= "adafruit,neopixel,matrix,16x16",
+		.width			= 16,
+		.height			= 16,
+		.get_pixel_coords	= rgbled_get_pixel_coords_meander,
+		.pitch			= 112,
+		.multiple		= rgbled_panel_multiple_height,
+	},
+	{
+		.compatible		= "adafruit,neopixel,matrix,32x8",
+		.width			= 32,
+		.height			= 8,
+		.pixel			= 256,
+		.get_pixel_coords	= rgbled_get_pixel_coords_meander,
+		.layout_yx		= true,
+		.pitch			= 112,
+		.multiple		= rgbled_panel_multiple_width,
+	},
+	{
+		.compatible		= "adafruit,neopixel,stick,8",
+		.width			= 8,
+		.height			= 1,
+		.pitch			= 156,
+		.multiple		= rgbled_panel_multiple_height,
+	},
+	{ }
+};
+EXPORT_SYMBOL_GPL(ws2812b_panels);
+
+/* the panel types of the ws2812 chip */
+struct rgbled_panel_info ws2812_panels[] = {
+	{
+		.compatible		= "worldsemi,ws2812,strip",
+		.width			= 1,
+		.height			= 1,
+		.flags			= RGBLED_FLAG_CHANGE_WHLP,
+	},
+	{ }
+};
+EXPORT_SYMBOL_GPL(ws2812_panels);
+
+/* the panel types of the apa102 chip */
+struct rgbled_panel_info apa102_panels[] = {
+	{
+		.compatible	= "shiji-led,apa102,strip",
+		.width		= 1,
+		.height		= 1,
+		.pitch		= 30,
+		.flags		= RGBLED_FLAG_CHANGE_WHLP,
+	},
+	{
+		.compatible	= "shiji-led,apa102,strip,30",
+		.width		= 1,
+		.height		= 1,
+		.pitch		= 30,
+		.flags		= RGBLED_FLAG_CHANGE_WHL,
+	},
+	{
+		.compatible	= "shiji-led,apa102,strip,60",
+		.width		= 1,
+		.height		= 1,
+		.pitch		= 60,
+		.flags		= RGBLED_FLAG_CHANGE_WHL,
+	},
+	{
+		.compatible	= "shiji-led,apa102,strip,144",
+		.width		= 1,
+		.height		= 1,
+		.pitch		= 144,
+		.flags		= RGBLED_FLAG_CHANGE_WHL,
+	},
+	{
+		.compatible	= "adafruit,dotstar,strip,30",
+		.width		= 1,
+		.height		= 1,
+		.pitch		= 30,
+		.flags		= RGBLED_FLAG_CHANGE_WHL,
+	},
+	{
+		.compatible	= "adafruit,dotstar,strip,60",
+		.width		= 1,
+		.height		= 1,
+		.pitch		= 60,
+		.flags		= RGBLED_FLAG_CHANGE_WHL,
+	},
+	{
+		.compatible	= "adafruit,dotstar,strip,144",
+		.width		= 1,
+		.height		= 1,
+		.pitch		= 144,
+		.flags		= RGBLED_FLAG_CHANGE_WHL,
+	},
+	{ }
+};
+EXPORT_SYMBOL_GPL(apa102_panels);
@@ -0,0 +1,326 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  asynchronous (triple buffered) spi output
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <linux/device.h>
+#include <linux/fb.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/spi/spi.h>
+#include <linux/version.h>
+#include <linux/wait.h>
+
+#include "rgbled-fb.h"
+#include "rgbled-fb-trace.h"
+
+static void rgbled_spi_output_complete(void *context);
+
+static void rgbled_spi_output_start(struct rgbled_spi_output *out,
+				    struct rgbled_spi_buffer *buf)
+{
+	int err;
+
+	err = spi_async(out->spi, &buf->msg);
+	if (err) {
+		dev_err_ratelimited(&out->spi->dev,
+				    "failed to submit frame: %i\n", err);
+		/* treat it as failed, which still moves on to pending */
+		buf->msg.status = err;
+		rgbled_spi_output_complete(buf);
+	}
+}
+
+static void rgbled_spi_output_frame_done(struct rgbled_fb *rfb)
+{
+	struct rgbled_spi_output *out;
+	u32 seq = READ_ONCE(rfb->frame_seq);
+
+	/* the oldest frame transmitted by all outputs */
+	list_for_each_entry(out, &rfb->spi_outputs, list)
+		if ((s32)(READ_ONCE(out->done_seq) - seq) < 0)
+			seq = READ_ONCE(out->done_seq);
+
+	rgbled_frame_done(rfb, seq);
+}
+
+static void rgbled_spi_output_complete(void *context)
+{
+	struct rgbled_spi_buffer *buf = context;
+	struct rgbled_spi_output *out = buf->out;
+	unsigned long flags;
+
+	trace_rgbled_spi_complete(out, buf);
+
+	/* the frame is done once all outputs have transmitted it
+	 * - a failed one never reached the leds, so it is not
+	 */
+	if (buf->msg.status) {
+		dev_err_ratelimited(&out->spi->dev,
+				    "frame transfer failed: %i\n",
+				    buf->msg.status);
+	} else {
+		WRITE_ONCE(out->done_seq, buf->seq);
+		rgbled_spi_output_frame_done(out->rfb);
+	}
+
+	/* promote the pending frame - if there is one */
+	spin_lock_irqsave(&out->lock, flags);
+	buf = out->stopping ? NULL : out->pending;
+	out->active = buf;
+	out->pending = NULL;
+	spin_unlock_irqrestore(&out->lock, flags);
+
+	if (buf)
+		rgbled_spi_output_start(out, buf);
+	else
+		wake_up(&out->idle);
+}
+
+void rgbled_spi_output_keep(struct rgbled_spi_output *out,
+			    size_t offset, size_t len)
+{
+	/* the frame submitted last is never the one getting filled */
+	if (out->last)
+		memcpy((u8 *)out->fill->data + offset,
+		       (u8 *)out->last->data + offset, len);
+}
+EXPORT_SYMBOL_GPL(rgbled_spi_output_keep);
+
+void rgbled_spi_output_submit(struct rgbled_spi_output *out)
+{
+	struct rgbled_spi_buffer *buf = out->fill;
+	unsigned long flags;
+	bool start;
+	int i;
+
+	buf->seq = out->rfb->frame_seq;
+
+	spin_lock_irqsave(&out->lock, flags);
+	if (out->stopping) {
+		spin_unlock_irqrestore(&out->lock, flags);
+		return;
+	}
+	trace_rgbled_spi_submit(out, buf, out->active && out->pending);
+	out->last = buf;
+	/* start immediately if idle - otherwise replace
+	 * a frame that did not make it onto the wire
+	 */
+	start = !out->active;
+	if (start) {
+		out->active = buf;
+	} else {
+		if (out->pending)
+			out->frames_dropped++;
+		out->pending = buf;
+	}
+	/* the next frame gets encoded into the buffer that is neither
+	 * on the wire nor queued - no locking needed while filling it,
+	 * as only we hand out free buffers
+	 */
+	for (i = 0; i < RGBLED_SPI_BUFFERS; i++) {
+		if ((&out->buffers[i] != out->active) &&
+		    (&out->buffers[i] != out->pending)) {
+			out->fill = &out->buffers[i];
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&out->lock, flags);
+
+	if (start)
+		rgbled_spi_output_start(out, buf);
+}
+EXPORT_SYMBOL_GPL(rgbled_spi_output_submit);
+
+void rgbled_spi_output_stop(struct rgbled_spi_output *out)
+{
+	unsigned long flags;
+
+	/* stop submitting and drop the pending frame */
+	spin_lock_irqsave(&out->lock, flags);
+	out->stopping = true;
+	out->pending = NULL;
+	spin_unlock_irqrestore(&out->lock, flags);
+
+	/* and wait for the frame on the wire */
+	wait_event(out->idle, !READ_ONCE(out->active));
+}
+
+static void rgbled_spi_output_release(struct device *dev, void *res)
+{
+	struct rgbled_spi_output *out = *(struct rgbled_spi_output **)res;
+	int i;
+
+	/* usually already stopped when the framebuffer got unregistered */
+	rgbled_spi_output_stop(out);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 9, 0)
+	for (i = 0; i < RGBLED_SPI_BUFFERS; i++)
+		if (out->buffers[i].msg.pre_optimized)
+			spi_unoptimize_message(&out->buffers[i].msg);
+#endif
+}
+
+static int rgbled_spi_output_match(struct device *dev, void *data)
+{
+	return dev->of_node == data;
+}
+
+static void rgbled_spi_output_put_device(struct device *dev, void *res)
+{
+	put_device(*(struct device **)res);
+}
+
+struct spi_device *rgbled_spi_output_device(struct rgbled_fb *rfb,
+					    struct spi_device *spi,
+					    u32 output)
+{
+	struct device_node *nc;
+	struct device *dev, **ptr;
+
+	/* the first output is the device we got probed for */
+	if (!output)
+		return spi;
+
+	nc = of_parse_phandle(spi->dev.of_node, "spi-outputs", output - 1);
+	if (!nc) {
+		fb_err(rfb->info, "no spi-outputs entry for output %u\n",
+		       output);
+		return ERR_PTR(-EINVAL);
+	}
+
+	/* the spi device may not have been created yet */
+	dev = bus_find_device(&spi_bus_type, NULL, nc,
+			      rgbled_spi_output_match);
+	of_node_put(nc);
+	if (!dev)
+		return ERR_PTR(-EPROBE_DEFER);
+
+	/* and hold on to it as long as we are bound */
+	ptr = devres_alloc(rgbled_spi_output_put_device,
+			   sizeof(*ptr), GFP_KERNEL);
+	if (!ptr) {
+		put_device(dev);
+		return ERR_PTR(-ENOMEM);
+	}
+	*ptr = dev;
+	devres_add(&spi->dev, ptr);
+
+	return to_spi_device(dev);
+}
+EXPORT_SYMBOL_GPL(rgbled_spi_output_device);
+
+int rgbled_spi_output_init(struct rgbled_spi_output *out,
+			   struct rgbled_fb *rfb,
+			   struct spi_device *spi,
+			   size_t len, size_t align,
+			   const void *init)
+{
+	/* the resources belong to the framebuffer device, which
+	 * is not the spi device for all but the first output
+	 */
+	struct device *dev = rfb->info->device;
+	struct rgbled_spi_output **ptr;
+	struct rgbled_spi_buffer *buf;
+	struct spi_transfer *xfer;
+	size_t segment;
+	int i, j, err;
+
+	out->rfb = rfb;
+	out->spi = spi;
+	out->len = len;
+	spin_lock_init(&out->lock);
+	list_add_tail(&out->list, &rfb->spi_outputs);
+
+	/* the frame clock can not go faster than the slowest output */
+	if (spi->max_speed_hz)
+		rfb->frame_wire_ns = max(rfb->frame_wire_ns,
+					 div_u64((u64)len * 8 * NSEC_PER_SEC,
+						 spi->max_speed_hz));
+	init_waitqueue_head(&out->idle);
+
+	/* split the frame into segments the controller (and its dma)
+	 * can handle in a single transfer - the transfers of a message
+	 * follow each other without any cs change or delay in between
+	 */
+	segment = min_t(size_t, spi_max_transfer_size(spi),
+			RGBLED_SPI_SEGMENT_MAX);
+	segment = max(rounddown(segment, align), align);
+	out->segment = min(segment, len);
+	out->segments = DIV_ROUND_UP(len, out->segment);
+
+	/* set up the buffers and their messages */
+	for (i = 0; i < RGBLED_SPI_BUFFERS; i++) {
+		buf = &out->buffers[i];
+		buf->out = out;
+		buf->xfers = devm_kcalloc(dev, out->segments,
+					  sizeof(*buf->xfers), GFP_KERNEL);
+		if (!buf->xfers)
+			return -ENOMEM;
+
+		/* contiguous, so drivers encode right into it - only huge
+		 * chains fall back to vmalloc, which the spi core maps
+		 * page by page for the controllers doing dma
+		 */
+		buf->data = devm_kzalloc(dev, len, GFP_KERNEL | __GFP_NOWARN);
+		if (!buf->data)
+			buf->data = rgbled_devm_vzalloc(dev, len);
+		if (!buf->data)
+			return -ENOMEM;
+		if (init)
+			memcpy(buf->data, init, len);
+
+		spi_message_init(&buf->msg);
+		buf->msg.complete = rgbled_spi_output_complete;
+		buf->msg.context = buf;
+
+		for (j = 0; j < out->segments; j++) {
+			xfer = &buf->xfers[j];
+			xfer->len = min(out->segment,
+					len - j * out->segment);
+			xfer->tx_buf = (u8 *)buf->data + j * out->segment;
+			spi_message_add_tail(xfer, &buf->msg);
+		}
+	}
+
+	out->fill = &out->buffers[0];
+
+	/* wait for transfers to finish on release */
+	ptr = devres_alloc(rgbled_spi_output_release,
+			   sizeof(*ptr), GFP_KERNEL);
+	if (!ptr)
+		return -ENOMEM;
+	*ptr = out;
+	devres_add(dev, ptr);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 9, 0)
+	/* the messages never change, so let the spi core validate, split
+	 * and prepare them once instead of on every frame - the dma
+	 * mapping stays with the controller, as it knows which device
+	 * (or dma channel) to map against
+	 */
+	for (i = 0; i < RGBLED_SPI_BUFFERS; i++) {
+		err = spi_optimize_message(spi, &out->buffers[i].msg);
+		if (err)
+			return err;
+	}
+#endif
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(rgbled_spi_output_init);
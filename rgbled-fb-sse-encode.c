@@ -0,0 +1,92 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  ssse3 kernel for the 3 times oversampled one-wire encoding
+ *
+ *  This file gets compiled with sse enabled, so it must only get
+ *  called between kernel_fpu_begin/end (see rgbled-fb-sse.c)
+ *  and can not include any kernel headers.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+/* no intrinsic headers - those pull in libc headers, so stick to the
+ * gcc vector extensions and the pshufb builtin
+ */
+typedef char v16qi __attribute__((vector_size(16)));
+typedef unsigned short v8hu __attribute__((vector_size(16)));
+typedef v16qi v16qi_u __attribute__((aligned(1)));
+
+#define V16(v)	{ v, v, v, v, v, v, v, v, v, v, v, v, v, v, v, v }
+
+void rgbled_encode_3bit_sse(unsigned char *dst, const unsigned char *src,
+			    int blocks);
+
+/* sse only shifts 16 bit lanes, so bits also move into the neighbouring
+ * byte - none of the masks keeps a bit position reached that way
+ */
+#define SHR(v, n)	((v16qi)((v8hu)(v) >> (n)))
+#define SHL(v, n)	((v16qi)((v8hu)(v) << (n)))
+#define SPREAD(v, shift, n, mask)	(shift(v, n) & (v16qi)V16(mask))
+#define PSHUFB(v, idx)	__builtin_ia32_pshufb128(v, idx)
+
+/* every bit b of a byte becomes 0b1b0, so bits 7..0 end up as:
+ *   high:   1 b7 0 1 b6 0 1 b5
+ *   medium: 0 1 b4 0 1 b3 0 1
+ *   low:    b2 0 1 b1 0 1 b0 0
+ * 16 bytes get spread per iteration and interleaved as high, medium,
+ * low via pshufb - exactly the same as the scalar table
+ */
+void rgbled_encode_3bit_sse(unsigned char *dst, const unsigned char *src,
+			    int blocks)
+{
+	/* the byte of high/medium/low landing in each output byte */
+	const v16qi h0 = { 0, -1, -1, 1, -1, -1, 2, -1,
+			   -1, 3, -1, -1, 4, -1, -1, 5 };
+	const v16qi m0 = { -1, 0, -1, -1, 1, -1, -1, 2,
+			   -1, -1, 3, -1, -1, 4, -1, -1 };
+	const v16qi l0 = { -1, -1, 0, -1, -1, 1, -1, -1,
+			   2, -1, -1, 3, -1, -1, 4, -1 };
+	const v16qi h1 = { -1, -1, 6, -1, -1, 7, -1, -1,
+			   8, -1, -1, 9, -1, -1, 10, -1 };
+	const v16qi m1 = { 5, -1, -1, 6, -1, -1, 7, -1,
+			   -1, 8, -1, -1, 9, -1, -1, 10 };
+	const v16qi l1 = { -1, 5, -1, -1, 6, -1, -1, 7,
+			   -1, -1, 8, -1, -1, 9, -1, -1 };
+	const v16qi h2 = { -1, 11, -1, -1, 12, -1, -1, 13,
+			   -1, -1, 14, -1, -1, 15, -1, -1 };
+	const v16qi m2 = { -1, -1, 11, -1, -1, 12, -1, -1,
+			   13, -1, -1, 14, -1, -1, 15, -1 };
+	const v16qi l2 = { 10, -1, -1, 11, -1, -1, 12, -1,
+			   -1, 13, -1, -1, 14, -1, -1, 15 };
+	v16qi v, h, m, l;
+
+	for (; blocks > 0; blocks--, src += 16, dst += 48) {
+		v = *(const v16qi_u *)src;
+
+		h = (v16qi)V16((char)0x92) | SPREAD(v, SHR, 1, 0x40) |
+		    SPREAD(v, SHR, 3, 0x08) | SPREAD(v, SHR, 5, 0x01);
+		m = (v16qi)V16(0x49) | SPREAD(v, SHL, 1, 0x20) |
+		    SPREAD(v, SHR, 1, 0x04);
+		l = (v16qi)V16(0x24) | SPREAD(v, SHL, 5, (char)0x80) |
+		    SPREAD(v, SHL, 3, 0x10) | SPREAD(v, SHL, 1, 0x02);
+
+		*(v16qi_u *)dst = PSHUFB(h, h0) | PSHUFB(m, m0) |
+				  PSHUFB(l, l0);
+		*(v16qi_u *)(dst + 16) = PSHUFB(h, h1) | PSHUFB(m, m1) |
+					 PSHUFB(l, l1);
+		*(v16qi_u *)(dst + 32) = PSHUFB(h, h2) | PSHUFB(m, m2) |
+					 PSHUFB(l, l2);
+	}
+}
@@ -0,0 +1,50 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  x86 glue for the vectorized encoders
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <asm/cpufeature.h>
+#include <asm/fpu/api.h>
+
+#include "rgbled-fb.h"
+
+/* below this the cost of saving the fpu state is not worth it */
+#define RGBLED_SSE_MIN_BLOCKS 4
+
+/* in rgbled-fb-sse-encode.c */
+void rgbled_encode_3bit_sse(unsigned char *dst, const unsigned char *src,
+			    int blocks);
+
+int rgbled_encode_3bit_simd(u8 *dst, const u8 *src, int count)
+{
+	int blocks = count / 16;
+
+	if (blocks < RGBLED_SSE_MIN_BLOCKS)
+		return 0;
+	/* pshufb is ssse3 - older cpus take the table */
+	if (!boot_cpu_has(X86_FEATURE_SSSE3) || !irq_fpu_usable())
+		return 0;
+
+	kernel_fpu_begin();
+	rgbled_encode_3bit_sse(dst, src, blocks);
+	kernel_fpu_end();
+
+	return blocks * 16;
+}
+EXPORT_SYMBOL_GPL(rgbled_encode_3bit_simd);
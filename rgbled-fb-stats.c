@@ -0,0 +1,144 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  frame timing statistics
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/fb.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+
+#include "rgbled-fb.h"
+
+static const char * const rgbled_stat_names[rgbled_stat_stages] = {
+	[rgbled_stat_snapshot]	= "snapshot",
+	[rgbled_stat_render]	= "render",
+	[rgbled_stat_limit]	= "limit",
+	[rgbled_stat_encode]	= "encode",
+	[rgbled_stat_submit]	= "submit",
+	[rgbled_stat_transmit]	= "transmit",
+	[rgbled_stat_latency]	= "latency",
+	[rgbled_stat_interval]	= "interval",
+};
+
+/* each stat has a single writer, so no locking or atomics are needed
+ * - readers may see a sample half way applied, which is fine for
+ * statistics
+ */
+void rgbled_stat_add(struct rgbled_stat *stat, u64 ns)
+{
+	if ((!stat->count) || (ns < stat->min))
+		stat->min = ns;
+	if (ns > stat->max)
+		stat->max = ns;
+	stat->sum += ns;
+	stat->count++;
+	stat->hist[min_t(int, ilog2(ns | 1), RGBLED_STAT_BUCKETS - 1)]++;
+}
+
+ktime_t rgbled_stat_stage(struct rgbled_stat *stat, ktime_t start)
+{
+	ktime_t now = ktime_get();
+
+	rgbled_stat_add(stat, ktime_to_ns(ktime_sub(now, start)));
+
+	return now;
+}
+
+static int rgbled_stats_show(struct seq_file *m, void *v)
+{
+	struct rgbled_fb *rfb = m->private;
+	struct rgbled_spi_output *out;
+	struct rgbled_stat stat;
+	u32 dropped = 0;
+	int i, b;
+
+	seq_printf(m, "%-10s %10s %10s %10s %10s\n",
+		   "stage", "count", "min_ns", "avg_ns", "max_ns");
+	for (i = 0; i < rgbled_stat_stages; i++) {
+		stat = rfb->stats[i];
+		seq_printf(m, "%-10s %10llu %10llu %10llu %10llu\n",
+			   rgbled_stat_names[i], stat.count, stat.min,
+			   stat.count ? div64_u64(stat.sum, stat.count) : 0,
+			   stat.max);
+	}
+
+	/* the histograms - only the populated range of buckets */
+	seq_puts(m, "\nlog2 histograms (bucket n: 2^n ns and up)\n");
+	for (i = 0; i < rgbled_stat_stages; i++) {
+		seq_printf(m, "%-10s", rgbled_stat_names[i]);
+		for (b = 0; b < RGBLED_STAT_BUCKETS; b++)
+			if (rfb->stats[i].hist[b])
+				seq_printf(m, " %i:%u", b,
+					   rfb->stats[i].hist[b]);
+		seq_putc(m, '\n');
+	}
+
+	/* frames replaced on the outputs before they hit the wire */
+	list_for_each_entry(out, &rfb->spi_outputs, list)
+		dropped += READ_ONCE(out->frames_dropped);
+
+	seq_puts(m, "\n");
+	seq_printf(m, "frames_submitted %u\n", READ_ONCE(rfb->frame_seq));
+	seq_printf(m, "frames_completed %u\n", READ_ONCE(rfb->frame_count));
+	seq_printf(m, "frames_dropped   %u\n", dropped);
+	seq_printf(m, "frames_empty     %u\n", READ_ONCE(rfb->frames_empty));
+	seq_printf(m, "frames_limited   %u\n",
+		   READ_ONCE(rfb->frames_limited));
+	seq_printf(m, "writes_coalesced %u\n",
+		   READ_ONCE(rfb->writes_coalesced));
+
+	return 0;
+}
+
+static int rgbled_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rgbled_stats_show, inode->i_private);
+}
+
+static const struct file_operations rgbled_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= rgbled_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* debugfs failures are not fatal - the statistics are just missing */
+void rgbled_register_debugfs(struct rgbled_fb *rfb)
+{
+	char name[32];
+
+	snprintf(name, sizeof(name), "rgbled-%s", dev_name(rfb->info->dev));
+	rfb->debugfs = debugfs_create_dir(name, NULL);
+	if (IS_ERR_OR_NULL(rfb->debugfs)) {
+		rfb->debugfs = NULL;
+		return;
+	}
+
+	debugfs_create_file("stats", 0444, rfb->debugfs, rfb,
+			    &rgbled_stats_fops);
+}
+
+void rgbled_unregister_debugfs(struct rgbled_fb *rfb)
+{
+	debugfs_remove_recursive(rfb->debugfs);
+	rfb->debugfs = NULL;
+}
@@ -0,0 +1,543 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb-test.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  KUnit tests for the coordinate mapping, the one-wire encoding
+ *  and the current limiter of the rgbled framebuffer - none of them
+ *  need any hardware, so they also run under UML
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <kunit/test.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+
+#include "rgbled-fb.h"
+
+/* deterministic pseudo random numbers, so failures can be reproduced */
+static u32 rgbled_test_random(u32 *state)
+{
+	*state = *state * 1664525 + 1013904223;
+
+	return *state >> 8;
+}
+
+/* coordinate mapping */
+
+struct rgbled_test_coords {
+	u32 x, y;
+};
+
+static void rgbled_test_chain(struct kunit *test,
+			      struct rgbled_panel_info *panel,
+			      const struct rgbled_test_coords *expected)
+{
+	struct rgbled_coordinates coord;
+	int i;
+
+	for (i = 0; i < panel->pixel; i++) {
+		panel->get_pixel_coords(NULL, panel, i, &coord);
+		KUNIT_EXPECT_EQ_MSG(test, coord.x, expected[i].x,
+				    "pixel %i", i);
+		KUNIT_EXPECT_EQ_MSG(test, coord.y, expected[i].y,
+				    "pixel %i", i);
+	}
+}
+
+static void rgbled_test_coords_linear(struct kunit *test)
+{
+	static const struct rgbled_test_coords expected[] = {
+		{ 5, 3 }, { 6, 3 }, { 7, 3 }, { 5, 4 }, { 6, 4 }, { 7, 4 },
+	};
+	static const struct rgbled_test_coords expected_yx[] = {
+		{ 5, 3 }, { 5, 4 }, { 6, 3 }, { 6, 4 }, { 7, 3 }, { 7, 4 },
+	};
+	static const struct rgbled_test_coords expected_inv[] = {
+		{ 7, 4 }, { 6, 4 }, { 5, 4 }, { 7, 3 }, { 6, 3 }, { 5, 3 },
+	};
+	struct rgbled_panel_info panel = {
+		.x = 5, .y = 3, .width = 3, .height = 2, .pixel = 6,
+		.get_pixel_coords = rgbled_get_pixel_coords_linear,
+	};
+
+	rgbled_test_chain(test, &panel, expected);
+
+	panel.layout_yx = true;
+	rgbled_test_chain(test, &panel, expected_yx);
+
+	panel.layout_yx = false;
+	panel.inverted_x = true;
+	panel.inverted_y = true;
+	rgbled_test_chain(test, &panel, expected_inv);
+}
+
+static void rgbled_test_coords_meander(struct kunit *test)
+{
+	/* rows - every other row right to left */
+	static const struct rgbled_test_coords expected[] = {
+		{ 5, 3 }, { 6, 3 }, { 7, 3 }, { 7, 4 }, { 6, 4 }, { 5, 4 },
+	};
+	/* columns - every other column bottom to top */
+	static const struct rgbled_test_coords expected_yx[] = {
+		{ 5, 3 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 4 }, { 6, 3 },
+	};
+	struct rgbled_panel_info panel = {
+		.x = 5, .y = 3, .width = 3, .height = 2, .pixel = 6,
+		.get_pixel_coords = rgbled_get_pixel_coords_meander,
+	};
+
+	rgbled_test_chain(test, &panel, expected);
+
+	panel.width = 2;
+	panel.height = 3;
+	panel.layout_yx = true;
+	rgbled_test_chain(test, &panel, expected_yx);
+}
+
+/* the panel types of the drivers */
+static struct rgbled_panel_info * const rgbled_test_panels[] = {
+	ws2812b_panels, ws2812_panels, apa102_panels, NULL
+};
+
+/* a panel of the given type as registered - strips get a length
+ * as they would via the device tree
+ */
+static void rgbled_test_panel_init(struct rgbled_panel_info *panel,
+				   const struct rgbled_panel_info *type)
+{
+	*panel = *type;
+	if (panel->flags & RGBLED_FLAG_CHANGE_WIDTH)
+		panel->width *= 150;
+	if (!panel->get_pixel_coords)
+		panel->get_pixel_coords = rgbled_get_pixel_coords_linear;
+	panel->pixel = panel->width * panel->height;
+}
+
+/* the chain order spelled out independently of the core */
+static void rgbled_test_expected(const struct rgbled_panel_info *panel,
+				 int num, struct rgbled_coordinates *coord)
+{
+	bool meander =
+		panel->get_pixel_coords == rgbled_get_pixel_coords_meander;
+	u32 major, minor, len;
+
+	len = panel->layout_yx ? panel->height : panel->width;
+	major = num / len;
+	minor = num % len;
+	if (meander && (major & 1))
+		minor = len - 1 - minor;
+
+	coord->x = panel->x + (panel->layout_yx ? major : minor);
+	coord->y = panel->y + (panel->layout_yx ? minor : major);
+}
+
+static void rgbled_test_panel(struct kunit *test,
+			      const struct rgbled_panel_info *type,
+			      u32 x, u32 y, u32 multiple)
+{
+	struct rgbled_panel_info panel;
+	struct rgbled_coordinates coord, expected;
+	unsigned long *seen;
+	int i;
+
+	rgbled_test_panel_init(&panel, type);
+	panel.x = x;
+	panel.y = y;
+	if (panel.multiple && (multiple > 1))
+		KUNIT_ASSERT_EQ(test, panel.multiple(&panel, multiple), 0);
+	KUNIT_ASSERT_EQ(test, panel.pixel, panel.width * panel.height);
+
+	seen = kunit_kzalloc(test, BITS_TO_LONGS(panel.pixel) * sizeof(long),
+			     GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, seen);
+
+	for (i = 0; i < panel.pixel; i++) {
+		panel.get_pixel_coords(NULL, &panel, i, &coord);
+		rgbled_test_expected(&panel, i, &expected);
+		KUNIT_EXPECT_EQ_MSG(test, coord.x, expected.x,
+				    "%s pixel %i", panel.compatible, i);
+		KUNIT_EXPECT_EQ_MSG(test, coord.y, expected.y,
+				    "%s pixel %i", panel.compatible, i);
+
+		/* and every pixel of the panel exactly once */
+		KUNIT_ASSERT_TRUE(test, (coord.x >= x) &&
+				  (coord.x < x + panel.width) &&
+				  (coord.y >= y) &&
+				  (coord.y < y + panel.height));
+		KUNIT_EXPECT_FALSE_MSG(
+			test, __test_and_set_bit(
+				(coord.y - y) * panel.width + coord.x - x,
+				seen),
+			"%s pixel %i mapped twice", panel.compatible, i);
+	}
+}
+
+static void rgbled_test_coords_panels(struct kunit *test)
+{
+	struct rgbled_panel_info * const *types;
+	const struct rgbled_panel_info *type;
+
+	for (types = rgbled_test_panels; *types; types++) {
+		for (type = *types; type->compatible; type++) {
+			rgbled_test_panel(test, type, 0, 0, 1);
+			rgbled_test_panel(test, type, 7, 13, 1);
+			rgbled_test_panel(test, type, 3, 5, 3);
+		}
+	}
+}
+
+static void rgbled_test_coords_timing(struct kunit *test)
+{
+	struct rgbled_panel_info * const *types;
+	const struct rgbled_panel_info *type;
+	struct rgbled_panel_info panel;
+	struct rgbled_coordinates coord;
+	const int rounds = 16;
+	ktime_t start;
+	u64 ns;
+	int i, r;
+
+	/* the matrices of the ws2812b and one strip are enough */
+	for (type = ws2812b_panels; type->compatible; type++) {
+		if ((type->flags & RGBLED_FLAG_CHANGE_WIDTH) &&
+		    (type != ws2812b_panels))
+			continue;
+		rgbled_test_panel_init(&panel, type);
+
+		start = ktime_get();
+		for (r = 0; r < rounds; r++)
+			for (i = 0; i < panel.pixel; i++)
+				panel.get_pixel_coords(NULL, &panel, i,
+						       &coord);
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		kunit_info(test, "%s: %llu ps/led\n", panel.compatible,
+			   div_u64(ns * 1000, rounds * panel.pixel));
+	}
+}
+
+/* one-wire encoding */
+
+/* every bit b becomes 0b1b0 - msb first */
+static void rgbled_test_encode_bits(u8 *dst, u8 val)
+{
+	u32 bits = 0;
+	int b;
+
+	for (b = 7; b >= 0; b--)
+		bits = (bits << 3) | 0x4 | (((val >> b) & 1) << 1);
+
+	dst[0] = bits >> 16;
+	dst[1] = bits >> 8;
+	dst[2] = bits;
+}
+
+static void rgbled_test_encode_table(struct kunit *test)
+{
+	u8 expected[3];
+	int i;
+
+	for (i = 0; i < 256; i++) {
+		rgbled_test_encode_bits(expected, i);
+		KUNIT_EXPECT_EQ_MSG(test, rgbled_encode_3bit_table[i][0],
+				    expected[0], "value %i", i);
+		KUNIT_EXPECT_EQ_MSG(test, rgbled_encode_3bit_table[i][1],
+				    expected[1], "value %i", i);
+		KUNIT_EXPECT_EQ_MSG(test, rgbled_encode_3bit_table[i][2],
+				    expected[2], "value %i", i);
+	}
+}
+
+/* long enough for the vector path, with an odd tail for the table */
+#define RGBLED_TEST_ENCODE_LEN	(16 * 64 + 7)
+
+static void rgbled_test_encode_fill(u8 *src, int len)
+{
+	u32 state = 1;
+	int i;
+
+	/* all values first, then random ones */
+	for (i = 0; i < len; i++)
+		src[i] = i < 256 ? i : rgbled_test_random(&state);
+}
+
+static void rgbled_test_encode_simd(struct kunit *test)
+{
+	u8 *src, *dst;
+	int i, done;
+
+	src = kunit_kzalloc(test, RGBLED_TEST_ENCODE_LEN, GFP_KERNEL);
+	dst = kunit_kzalloc(test, 3 * RGBLED_TEST_ENCODE_LEN, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, src);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dst);
+	rgbled_test_encode_fill(src, RGBLED_TEST_ENCODE_LEN);
+
+	/* the vector path on its own has to be bit-exact with the table */
+	done = rgbled_encode_3bit_simd(dst, src, RGBLED_TEST_ENCODE_LEN);
+	if (!done)
+		kunit_info(test, "no vectorized encoder\n");
+	KUNIT_EXPECT_LE(test, done, RGBLED_TEST_ENCODE_LEN);
+	for (i = 0; i < done; i++)
+		KUNIT_EXPECT_EQ_MSG(test,
+				    memcmp(&dst[3 * i],
+					   rgbled_encode_3bit_table[src[i]],
+					   3), 0,
+				    "byte %i (value %u)", i, src[i]);
+
+	/* and the combination for all lengths around the block size */
+	for (i = 0; i < 3 * 64 + 1; i++) {
+		memset(dst, 0, 3 * RGBLED_TEST_ENCODE_LEN);
+		rgbled_encode_3bit(dst, src, RGBLED_TEST_ENCODE_LEN - i);
+		for (done = 0; done < RGBLED_TEST_ENCODE_LEN - i; done++)
+			if (memcmp(&dst[3 * done],
+				   rgbled_encode_3bit_table[src[done]], 3))
+				break;
+		KUNIT_EXPECT_EQ_MSG(test, done, RGBLED_TEST_ENCODE_LEN - i,
+				    "length %i", RGBLED_TEST_ENCODE_LEN - i);
+		/* and nothing written beyond the end */
+		if (i)
+			KUNIT_EXPECT_EQ(test,
+					dst[3 * (RGBLED_TEST_ENCODE_LEN - i)],
+					0);
+	}
+}
+
+static void rgbled_test_encode_timing(struct kunit *test)
+{
+	/* a strip of 10000 leds */
+	const int len = 3 * 10000, rounds = 16;
+	ktime_t start;
+	u8 *src, *dst;
+	u64 ns;
+	int r;
+
+	src = kunit_kzalloc(test, len, GFP_KERNEL);
+	dst = kunit_kzalloc(test, 3 * len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, src);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dst);
+	rgbled_test_encode_fill(src, len);
+
+	start = ktime_get();
+	for (r = 0; r < rounds; r++)
+		rgbled_encode_3bit(dst, src, len);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	kunit_info(test, "ws2812 encode: %llu ps/led\n",
+		   div_u64(ns * 1000, rounds * (len / 3)));
+}
+
+/* pixel encoding of the chips */
+
+static void rgbled_test_encode_ws2812(struct kunit *test)
+{
+	static const struct rgbled_pixel pix[] = {
+		{ .red = 0x12, .green = 0x34, .blue = 0x56, .brightness = 255 },
+		{ .red = 255, .green = 128, .blue = 1, .brightness = 128 },
+		{ .red = 255, .green = 255, .blue = 255, .brightness = 0 },
+	};
+	/* green, red, blue - with the channels scaled by the alpha */
+	static const u8 expected[] = {
+		0x34, 0x12, 0x56,
+		64, 128, 0,
+		0, 0, 0,
+	};
+	struct ws2812b_pixel dst[ARRAY_SIZE(pix)];
+	u8 grb[3 * ARRAY_SIZE(pix)], bits[3];
+	int i;
+
+	rgbled_encode_ws2812(dst, grb, pix, ARRAY_SIZE(pix));
+	for (i = 0; i < ARRAY_SIZE(expected); i++) {
+		KUNIT_EXPECT_EQ_MSG(test, grb[i], expected[i], "byte %i", i);
+		rgbled_test_encode_bits(bits, expected[i]);
+		KUNIT_EXPECT_EQ_MSG(test, memcmp((u8 *)dst + 3 * i, bits, 3),
+				    0, "byte %i", i);
+	}
+}
+
+static void rgbled_test_encode_apa102(struct kunit *test)
+{
+	static const struct rgbled_pixel pix[] = {
+		{ .red = 0x12, .green = 0x34, .blue = 0x56, .brightness = 255 },
+		{ .red = 255, .green = 128, .blue = 1, .brightness = 128 },
+		{ .red = 255, .green = 255, .blue = 255, .brightness = 0 },
+	};
+	/* header | 5 bit level, blue, green, red - the channels making up
+	 * for the steps of the level: 128 / 255 is reached via 16 / 31
+	 */
+	static const u8 expected[] = {
+		0xff, 0x56, 0x34, 0x12,
+		0xf0, 1, 124, 248,
+		0xe0, 0, 0, 0,
+	};
+	/* 17 leds, so the trailing clocks take 3 bytes */
+	const u32 leds = 17;
+	u32 len = rgbled_apa102_frame_len(leds);
+	u8 *frame;
+	int i;
+
+	KUNIT_EXPECT_EQ(test, len, (leds + 1) * 4 + 3);
+	frame = kunit_kzalloc(test, len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, frame);
+
+	/* the start frame, all leds off and the trailing clocks */
+	rgbled_apa102_frame_init(frame, leds);
+	for (i = 0; i < len; i++) {
+		if (i < 4)
+			KUNIT_EXPECT_EQ_MSG(test, frame[i], 0, "byte %i", i);
+		else if (i >= (leds + 1) * 4)
+			KUNIT_EXPECT_EQ_MSG(test, frame[i], 0xff,
+					    "byte %i", i);
+		else
+			KUNIT_EXPECT_EQ_MSG(test, frame[i],
+					    (i & 3) ? 0 : 0xe0,
+					    "byte %i", i);
+	}
+
+	/* the pixel at their place - the rest untouched */
+	rgbled_encode_apa102((struct apa102_pixel *)frame + 1 + 5, pix,
+			     ARRAY_SIZE(pix));
+	for (i = 0; i < ARRAY_SIZE(expected); i++)
+		KUNIT_EXPECT_EQ_MSG(test, frame[(1 + 5) * 4 + i], expected[i],
+				    "byte %i", i);
+	KUNIT_EXPECT_EQ(test, frame[5 * 4], 0xe0);
+	KUNIT_EXPECT_EQ(test, frame[(1 + 5 + 3) * 4], 0xe0);
+	KUNIT_EXPECT_EQ(test, frame[(leds + 1) * 4], 0xff);
+}
+
+static void rgbled_test_encode_apa102_levels(struct kunit *test)
+{
+	struct rgbled_pixel pix = { };
+	struct apa102_pixel dst;
+	u32 level, c, b;
+
+	/* level * channel / 31 as close to value * brightness / 255
+	 * as the channel resolution allows
+	 */
+	for (b = 0; b < 256; b++) {
+		for (c = 0; c < 256; c += 5) {
+			pix.red = c;
+			pix.brightness = b;
+			rgbled_encode_apa102(&dst, &pix, 1);
+
+			level = dst.brightness & 0x1f;
+			KUNIT_ASSERT_EQ(test, dst.brightness & 0xe0, 0xe0);
+			KUNIT_ASSERT_EQ(test, level, DIV_ROUND_UP(b * 31, 255));
+			KUNIT_ASSERT_LE_MSG(test,
+					    abs((int)(dst.r * level * 255) -
+						(int)(c * b * 31)),
+					    (int)(level * 255 / 2),
+					    "value %u brightness %u", c, b);
+		}
+	}
+}
+
+/* current limiter */
+
+/* drive at full brightness in mA * 255^3 - as in rgbled_panel_info */
+#define RGBLED_TEST_MA(ma)	((u64)(ma) * 255 * 255 * 255)
+#define RGBLED_TEST_FULL	((u64)255 * 255 * 255 * 255)
+
+static void rgbled_test_limit_cases(struct kunit *test)
+{
+	/* no limit or nothing lit */
+	KUNIT_EXPECT_EQ(test, rgbled_limit_brightness(200, RGBLED_TEST_MA(100),
+						      10, 0), 200);
+	KUNIT_EXPECT_EQ(test, rgbled_limit_brightness(200, 0, 10, 50), 200);
+
+	/* within the limit */
+	KUNIT_EXPECT_EQ(test, rgbled_limit_brightness(255, RGBLED_TEST_MA(40),
+						      10, 50), 255);
+	KUNIT_EXPECT_EQ(test, rgbled_limit_brightness(100, RGBLED_TEST_MA(100),
+						      0, 50), 100);
+
+	/* 100mA at 255 - 50mA are reached at 127.5 */
+	KUNIT_EXPECT_EQ(test, rgbled_limit_brightness(255, RGBLED_TEST_MA(100),
+						      0, 50), 127);
+	/* the base current is not scaled */
+	KUNIT_EXPECT_EQ(test, rgbled_limit_brightness(255, RGBLED_TEST_MA(100),
+						      25, 75), 127);
+
+	/* the base current alone exceeds the limit */
+	KUNIT_EXPECT_EQ(test, rgbled_limit_brightness(255, RGBLED_TEST_MA(1),
+						      50, 50), 0);
+	KUNIT_EXPECT_EQ(test, rgbled_limit_brightness(255, RGBLED_TEST_MA(1),
+						      60, 50), 0);
+
+	/* a huge chain - 10000 leds at 51mA */
+	KUNIT_EXPECT_EQ(test,
+			rgbled_limit_brightness(255, RGBLED_TEST_MA(510000),
+						10000, 20000), 5);
+}
+
+static void rgbled_test_limit_random(struct kunit *test)
+{
+	u32 state = 1, base, limit;
+	u8 brightness, b;
+	u64 drive;
+	int i;
+
+	for (i = 0; i < 100000; i++) {
+		brightness = rgbled_test_random(&state);
+		drive = RGBLED_TEST_MA(rgbled_test_random(&state) % 100000) +
+			rgbled_test_random(&state) % RGBLED_TEST_MA(1);
+		base = rgbled_test_random(&state) % 20000;
+		limit = rgbled_test_random(&state) % 120000;
+
+		b = rgbled_limit_brightness(brightness, drive, base, limit);
+		KUNIT_ASSERT_LE(test, b, brightness);
+		if ((!limit) || (!drive)) {
+			KUNIT_ASSERT_EQ(test, b, brightness);
+			continue;
+		}
+		if (limit <= base) {
+			KUNIT_ASSERT_EQ(test, b, 0);
+			continue;
+		}
+
+		/* within the limit - and the highest such brightness */
+		KUNIT_ASSERT_LE(test, drive * b,
+				(u64)(limit - base) * RGBLED_TEST_FULL);
+		if (b < brightness)
+			KUNIT_ASSERT_GT(test, drive * (b + 1),
+					(u64)(limit - base) *
+					RGBLED_TEST_FULL);
+	}
+}
+
+static struct kunit_case rgbled_fb_test_cases[] = {
+	KUNIT_CASE(rgbled_test_coords_linear),
+	KUNIT_CASE(rgbled_test_coords_meander),
+	KUNIT_CASE(rgbled_test_coords_panels),
+	KUNIT_CASE(rgbled_test_coords_timing),
+	KUNIT_CASE(rgbled_test_encode_table),
+	KUNIT_CASE(rgbled_test_encode_simd),
+	KUNIT_CASE(rgbled_test_encode_timing),
+	KUNIT_CASE(rgbled_test_encode_ws2812),
+	KUNIT_CASE(rgbled_test_encode_apa102),
+	KUNIT_CASE(rgbled_test_encode_apa102_levels),
+	KUNIT_CASE(rgbled_test_limit_cases),
+	KUNIT_CASE(rgbled_test_limit_random),
+	{ }
+};
+
+static struct kunit_suite rgbled_fb_test_suite = {
+	.name = "rgbled-fb",
+	.test_cases = rgbled_fb_test_cases,
+};
+kunit_test_suite(rgbled_fb_test_suite);
+
+MODULE_AUTHOR("Martin Sperl <kernel@martin.sperl.org>");
+MODULE_DESCRIPTION("KUnit tests for the RGB LED framebuffer");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,175 @@
+/*
+ *  linux/drivers/video/fb/rgbled-fb.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  generic Frame buffer code for LED strips
+ *  tracepoints of the frame pipeline
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM rgbled
+
+#if !defined(__RGBLED_FB_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define __RGBLED_FB_TRACE_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+#include "rgbled-fb.h"
+
+/* a frame got requested - coalesced if one was already waiting */
+TRACE_EVENT(rgbled_frame_schedule,
+	TP_PROTO(struct rgbled_fb *rfb, bool coalesced),
+	TP_ARGS(rfb, coalesced),
+
+	TP_STRUCT__entry(
+		__field(int,		node)
+		__field(u32,		seq)
+		__field(bool,		coalesced)
+	),
+
+	TP_fast_assign(
+		__entry->node		= rfb->info->node;
+		__entry->seq		= rfb->frame_seq + 1;
+		__entry->coalesced	= coalesced;
+	),
+
+	TP_printk("fb%d seq=%u coalesced=%d",
+		  __entry->node, __entry->seq, __entry->coalesced)
+);
+
+DECLARE_EVENT_CLASS(rgbled_frame,
+	TP_PROTO(struct rgbled_fb *rfb, u32 seq),
+	TP_ARGS(rfb, seq),
+
+	TP_STRUCT__entry(
+		__field(int,		node)
+		__field(u32,		seq)
+		__field(int,		pixel)
+	),
+
+	TP_fast_assign(
+		__entry->node		= rfb->info->node;
+		__entry->seq		= seq;
+		__entry->pixel		= rfb->pixel;
+	),
+
+	TP_printk("fb%d seq=%u pixel=%d",
+		  __entry->node, __entry->seq, __entry->pixel)
+);
+
+/* rendering of a frame with modified panels starts */
+DEFINE_EVENT(rgbled_frame, rgbled_render_start,
+	TP_PROTO(struct rgbled_fb *rfb, u32 seq),
+	TP_ARGS(rfb, seq)
+);
+
+/* the frame got encoded and is handed to finish_work */
+DEFINE_EVENT(rgbled_frame, rgbled_render_end,
+	TP_PROTO(struct rgbled_fb *rfb, u32 seq),
+	TP_ARGS(rfb, seq)
+);
+
+/* the frame got latched on all outputs */
+DEFINE_EVENT(rgbled_frame, rgbled_frame_done,
+	TP_PROTO(struct rgbled_fb *rfb, u32 seq),
+	TP_ARGS(rfb, seq)
+);
+
+/* the brightness chosen by the current limiter and the resulting estimate */
+TRACE_EVENT(rgbled_limit,
+	TP_PROTO(struct rgbled_fb *rfb, u32 seq),
+	TP_ARGS(rfb, seq),
+
+	TP_STRUCT__entry(
+		__field(int,		node)
+		__field(u32,		seq)
+		__field(u8,		brightness)
+		__field(u8,		brightness_effective)
+		__field(u32,		current_ma)
+		__field(u32,		current_limit)
+	),
+
+	TP_fast_assign(
+		__entry->node			= rfb->info->node;
+		__entry->seq			= seq;
+		__entry->brightness		= rfb->brightness;
+		__entry->brightness_effective	= rfb->brightness_effective;
+		__entry->current_ma		= rfb->current_tmp;
+		__entry->current_limit		= rfb->current_limit;
+	),
+
+	TP_printk("fb%d seq=%u brightness=%u effective=%u current=%umA limit=%umA",
+		  __entry->node, __entry->seq, __entry->brightness,
+		  __entry->brightness_effective, __entry->current_ma,
+		  __entry->current_limit)
+);
+
+/* a frame got queued on an output - replacing a pending one if dropped */
+TRACE_EVENT(rgbled_spi_submit,
+	TP_PROTO(struct rgbled_spi_output *out, struct rgbled_spi_buffer *buf,
+		 bool dropped),
+	TP_ARGS(out, buf, dropped),
+
+	TP_STRUCT__entry(
+		__string(dev,		dev_name(&out->spi->dev))
+		__field(u32,		seq)
+		__field(size_t,		len)
+		__field(bool,		dropped)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(&out->spi->dev));
+		__entry->seq		= buf->seq;
+		__entry->len		= out->len;
+		__entry->dropped	= dropped;
+	),
+
+	TP_printk("%s seq=%u len=%zu dropped=%d",
+		  __get_str(dev), __entry->seq, __entry->len,
+		  __entry->dropped)
+);
+
+/* a frame finished transmitting on an output */
+TRACE_EVENT(rgbled_spi_complete,
+	TP_PROTO(struct rgbled_spi_output *out, struct rgbled_spi_buffer *buf),
+	TP_ARGS(out, buf),
+
+	TP_STRUCT__entry(
+		__string(dev,		dev_name(&out->spi->dev))
+		__field(u32,		seq)
+		__field(size_t,		len)
+		__field(int,		status)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(&out->spi->dev));
+		__entry->seq		= buf->seq;
+		__entry->len		= out->len;
+		__entry->status		= buf->msg.status;
+	),
+
+	TP_printk("%s seq=%u len=%zu status=%d",
+		  __get_str(dev), __entry->seq, __entry->len,
+		  __entry->status)
+);
+
+#endif /* __RGBLED_FB_TRACE_H */
+
+/* this part must be outside the header guard */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE rgbled-fb-trace
+#include <trace/define_trace.h>
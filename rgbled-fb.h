@@ -19,11 +19,16 @@
 #ifndef __RGBLED_FB_H
 #define __RGBLED_FB_H
 
+#include <linux/atomic.h>
 #include <linux/fb.h>
+#include <linux/hrtimer.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
 #include <linux/list_sort.h>
+#include <linux/spi/spi.h>
 #include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 
 /**
  * struct rgbled_pixel - the pixel format used by rgbled
@@ -44,6 +49,23 @@ struct rgbled_pixel {
 	u8			brightness;
 };
 
+/**
+ * struct rgbled_pixel16 - the pixel format with 16 bits per channel
+ * @red: red value
+ * @green: green value
+ * @blue: blue value
+ * @brighness: global brightness (encoded as alpha in fb)
+ *
+ * used when configured via bits-per-channel = <16>, which
+ * allows more than 256 levels when combined with dithering
+ */
+struct rgbled_pixel16 {
+	u16			red;
+	u16			green;
+	u16			blue;
+	u16			brightness;
+};
+
 /**
  * enum rgbled_pixeltype - define type of value passed
  * to some of the functions
@@ -68,8 +90,57 @@ struct rgbled_coordinates {
 	int			y;
 };
 
+/* number of entries in a gamma/transfer curve */
+#define RGBLED_GAMMA_SIZE	256
+
 struct rgbled_panel_info;
 
+/* the stages of a frame that get timed */
+enum rgbled_stat_stage {
+	rgbled_stat_snapshot,	/* collect the damage and copy vmem */
+	rgbled_stat_render,	/* accumulate the currents */
+	rgbled_stat_limit,	/* apply the current limits */
+	rgbled_stat_encode,	/* encode with the final brightness */
+	rgbled_stat_submit,	/* finish_work handing over the frame */
+	rgbled_stat_transmit,	/* submitted until latched on all outputs */
+	rgbled_stat_latency,	/* first modification until latched */
+	rgbled_stat_interval,	/* between two frames getting latched */
+	rgbled_stat_stages
+};
+
+/* number of log2 buckets of the timing histograms (1ns up to 2s) */
+#define RGBLED_STAT_BUCKETS	32
+
+/**
+ * struct rgbled_stat - timing statistics of a single stage
+ * @count: number of samples
+ * @sum: sum of all samples in ns
+ * @min: shortest sample in ns
+ * @max: longest sample in ns
+ * @hist: histogram - bucket n counts samples of 2^n up to 2^(n+1)-1 ns
+ */
+struct rgbled_stat {
+	u64			count;
+	u64			sum;
+	u64			min;
+	u64			max;
+	u32			hist[RGBLED_STAT_BUCKETS];
+};
+
+/* number of frames in flight tracked for the transmit/latency timing */
+#define RGBLED_FRAME_TIMES	4
+
+/**
+ * struct rgbled_frame_times - start timestamps of a frame in flight
+ * @damage: first modification of vmem that went into the frame
+ *          (0 if the frame got triggered by dithering only)
+ * @submit: the frame got handed to finish_work
+ */
+struct rgbled_frame_times {
+	ktime_t			damage;
+	ktime_t			submit;
+};
+
 /**
  * struct rgbled_fb - the main rgbled framebuffer structure
  * @info: pointer to struct fb_info
@@ -80,15 +151,37 @@ struct rgbled_panel_info;
  * @name: name of the device
  * @of_node: reference to the device_node that initialized this
  * @duplicate: flag to detect if we have duplicate board_ids
- * @vmem: allocated framebuffer
+ * @vmem: allocated framebuffer (struct rgbled_pixel16 with 16 bits per
+ *        channel) holding @buffers screens for page flipping
+ * @screen: the screen inside @vmem that gets rendered
+ * @shadow: consistent copy of @screen taken at the start of a frame,
+ *          which is what actually gets rendered
+ * @snapshot_pages: bitmap of the pages copied to @shadow for this frame
+ * @vmem_writers: number of kernel side writers modifying @vmem right now
+ * @vmem_gen: incremented whenever a kernel side writer finishes
+ * @buffers: number of screens in @vmem
+ * @pan_offset: byte offset of the screen that gets rendered from the
+ *              next frame on (protected by @damage_lock)
+ * @bits_per_channel: 8 or 16 bits per channel in vmem
+ * @pixel_map: chain-order table of screen offsets for all panels
+ *             (RGBLED_PIXEL_MAP_BLACK for pixel outside of the screen)
  * @width: framebuffer width
  * @height: framebuffer height
  * @pixel: pixel string length
+ * @panel_count: number of panels
+ * @outputs: number of outputs the panels are distributed over
  * @expose_all_led: expose all led in all panels via sysfs using led api
+ * @hw_brightness: the leds dim in hardware - the luts then only apply gamma
+ *                 and the brightness of the pixel handed to @setPixelValue
+ *                 includes global and panel brightness
  * @deferred_work: the deferred work function - typically default
  * @getPixelValue: get the corresponding pixelvalue of for the specific
- *                 panel coordinates
+ *                 panel coordinates (gamma and global/panel brightness
+ *                 get applied afterwards by the core)
  * @setPixelValue: set the string pixel value inside the panel
+ *                 (pixel_num counts within the output of the panel)
+ * @setPixelValues: optional batched version of @setPixelValue - gets
+ *                  all pixel of a panel in chain order in one call
  * @finish_work: for default implementation of filling the string
  *               final submit of the data to the device
  * @current_limit: current limit for the whole framebuffer
@@ -104,9 +197,64 @@ struct rgbled_panel_info;
  * @led_current_max_blue: current consumed by blue LED
  *                        at maximum brightness in mA
  * @brightness: global brightness for thled panel, that can be controlled
- *              but gets scaled down to limit current to preset values
- *              based on global or panel current limits
+ * @brightness_effective: the brightness actually used for the current frame
+ *                        - @brightness scaled down to limit current to
+ *                        preset values based on global or panel limits
  * @screen_updates: number of screen updates executed
+ * @gamma: per channel transfer curves (indexed by rgbled_pixeltype)
+ * @gamma_seq: incremented whenever @gamma gets modified
+ * @gamma_active: the transfer curves used by the current update
+ * @gamma_active_seq: the @gamma_seq of @gamma_active
+ * @damage_lock: spinlock protecting the damage information
+ *               (also taken from led triggers, so irqsave)
+ * @damage_pages: bitmap of screen pages modified since the last update
+ * @damage_all: request a full redraw of all panels
+ * @pages: number of pages of a screen
+ * @page_panels: per screen page a bitmap of the panels that display
+ *               pixel from this page
+ * @dirty_panels: bitmap of panels that need rendering in this update
+ * @dither: enable temporal dithering
+ * @dither_active: the @dither setting the current frame gets encoded with
+ * @stage: chain order channel values in 8.8 fixed point
+ *         (used with dithering or 16 bits per channel)
+ * @stage_alpha: chain order pixel brightness belonging to @stage
+ * @stage_out: chain order channel values after dithering
+ * @residual: per channel fraction carried over to the next frame
+ * @batch: chain order pixel handed to @setPixelValues
+ * @chunks: the chain split into units of rendering work
+ * @chunk_count: number of @chunks
+ * @chunk_next: the next chunk to get rendered in the running pass
+ * @render_pass: the pass the render workers are running
+ * @render_wq: workqueue for rendering on multiple cpus
+ * @render_workers: the work items rendering in parallel with the
+ *                  deferred io worker
+ * @render_worker_count: number of @render_workers
+ * @refresh_rate_hz: target frame rate (0 = as fast as the outputs allow)
+ * @frame_wire_ns: time it takes to transmit a frame on the slowest output
+ * @frame_lock: protects the frame clock state
+ *              (also taken from led triggers, so irqsave)
+ * @frame_timer: the frame clock - fires at the start of a frame slot
+ * @frame_work: renders and submits a frame
+ * @frame_last: start of the last frame slot
+ * @frame_scheduled: a frame got scheduled, but did not start yet
+ * @frame_stopped: do not schedule any further frames
+ * @frame_seq: sequence number of the last frame handed to @finish_work
+ * @frame_count: sequence number of the last frame that got transmitted
+ *               completely (on all outputs)
+ * @frame_timestamp: the time @frame_count completed
+ * @vsync_wait: woken whenever @frame_count changes
+ * @frame_count_kn: the sysfs node of frame_count - notified from
+ *                  rgbled_frame_done, which may not sleep
+ * @spi_outputs: the rgbled_spi_outputs of this framebuffer
+ * @stats: per stage frame timing statistics
+ * @frame_times: start timestamps of the frames in flight
+ *               (indexed by frame sequence number)
+ * @damage_time: the time vmem got modified first since the last frame
+ *               (protected by @damage_lock)
+ * @writes_coalesced: modifications merged into an already scheduled frame
+ * @frames_empty: frame slots without anything to render
+ * @frames_limited: frames with the brightness reduced by current limits
+ * @debugfs: the debugfs directory exposing the statistics
  */
 struct rgbled_fb {
 	struct fb_info		*info;
@@ -120,13 +268,25 @@ struct rgbled_fb {
 	bool			duplicate_id;
 
 	struct rgbled_pixel	*vmem;
+	struct rgbled_pixel	*screen;
+	struct rgbled_pixel	*shadow;
+	unsigned long		*snapshot_pages;
+	atomic_t		vmem_writers;
+	atomic_t		vmem_gen;
+	u32			buffers;
+	size_t			pan_offset;
+	u32			bits_per_channel;
+	u32			*pixel_map;
 	int			width;
 	int			height;
 	int			vmem_size;
 
 	int			pixel;
+	int			panel_count;
+	int			outputs;
 
 	bool			expose_all_led;
+	bool			hw_brightness;
 
 	void (*deferred_work)(struct rgbled_fb *rfb);
 	void (*get_pixel_value)(struct rgbled_fb *rfb,
@@ -137,6 +297,11 @@ struct rgbled_fb {
 				struct rgbled_panel_info *panel,
 				int pixel_num,
 				struct rgbled_pixel *pix);
+	void (*set_pixel_values)(struct rgbled_fb *rfb,
+				 struct rgbled_panel_info *panel,
+				 int pixel_num,
+				 const struct rgbled_pixel *pix,
+				 int count);
 	void (*finish_work)(struct rgbled_fb *rfb);
 
 	/* current estimates in mA */
@@ -154,9 +319,108 @@ struct rgbled_fb {
 
 	/* global brightness */
 	u8			brightness;
+	u8			brightness_effective;
 
 	/* count of screen updates */
 	u32			screen_updates;
+
+	/* transfer curves */
+	u8			gamma[3][RGBLED_GAMMA_SIZE];
+	u32			gamma_seq;
+	u8			gamma_active[3][RGBLED_GAMMA_SIZE];
+	u32			gamma_active_seq;
+
+	/* damage tracking */
+	spinlock_t		damage_lock;
+	unsigned long		*damage_pages;
+	bool			damage_all;
+	int			pages;
+	unsigned long		*page_panels;
+	unsigned long		*dirty_panels;
+
+	/* dithering */
+	bool			dither;
+	bool			dither_active;
+	u16			*stage;
+	u8			*stage_alpha;
+	u8			*stage_out;
+	u8			*residual;
+
+	/* batched encoding */
+	struct rgbled_pixel	*batch;
+
+	/* parallel rendering */
+	struct rgbled_chunk	*chunks;
+	int			chunk_count;
+	atomic_t		chunk_next;
+	int			render_pass;
+	struct workqueue_struct	*render_wq;
+	struct rgbled_render_worker *render_workers;
+	int			render_worker_count;
+
+	/* frame clock */
+	u32			refresh_rate_hz;
+	u64			frame_wire_ns;
+	spinlock_t		frame_lock;
+	struct hrtimer		frame_timer;
+	struct work_struct	frame_work;
+	ktime_t			frame_last;
+	bool			frame_scheduled;
+	bool			frame_stopped;
+
+	/* frame completion */
+	u32			frame_seq;
+	u32			frame_count;
+	ktime_t			frame_timestamp;
+	wait_queue_head_t	vsync_wait;
+	struct kernfs_node	*frame_count_kn;
+	struct list_head	spi_outputs;
+
+	/* statistics - lock free, only written by a single context */
+	struct rgbled_stat	stats[rgbled_stat_stages];
+	struct rgbled_frame_times frame_times[RGBLED_FRAME_TIMES];
+	ktime_t			damage_time;
+	u32			writes_coalesced;
+	u32			frames_empty;
+	u32			frames_limited;
+	struct dentry		*debugfs;
+};
+
+/* the maximum number of screens for page flipping */
+#define RGBLED_MAX_BUFFERS	16
+
+/* the maximum number of pixel rendered as a single unit of work */
+#define RGBLED_CHUNK_PIXEL	512
+
+/**
+ * struct rgbled_chunk - a range of pixel of a panel rendered as one unit
+ * @panel: the panel the pixel belong to
+ * @first: the first pixel within the panel
+ * @count: the number of pixel
+ * @start_pixel: the position of @first in the whole chain
+ * @drive: the part of panel->current_drive of these pixel
+ * @dithering: some of the pixel show fractional values
+ *
+ * chunks of a single pass may get rendered concurrently on different
+ * cpus - they only write to their own range of the chain
+ */
+struct rgbled_chunk {
+	struct rgbled_panel_info *panel;
+	u32			first;
+	u32			count;
+	u32			start_pixel;
+	u64			drive;
+	bool			dithering;
+};
+
+/**
+ * struct rgbled_render_worker - work item rendering chunks
+ * @work: the work item
+ * @rfb: the framebuffer to render
+ */
+struct rgbled_render_worker {
+	struct work_struct	work;
+	struct rgbled_fb	*rfb;
 };
 
 /**
@@ -164,6 +428,10 @@ struct rgbled_fb {
  * that make up the whole framebuffer
  * @list - list of panels inside a rgb_framebuffer
  * @id - the sequence number of this panel in the list of all panels
+ * @index - the position of this panel in the chain (0 based)
+ * @output - the output (spi device) the panel is connected to
+ * @output_pixel - the position of the first pixel of this panel
+ *                 within the chain of its output
  * @compatible - compatible string of the pannel
  * @name - name of the panel (mostly for reference)
  * @x - the x start coordinate of the panel inside the framebuffer
@@ -187,11 +455,22 @@ struct rgbled_fb {
  *                       in the framebuffer
  * @getPixelValue: allows for custom methods to get the real pixel value
  *                 to display on the LED - e.g: local or radial averaging
+ * @pixel_map: the portion of rfb->pixel_map that belongs to this panel
+ * @dirty: the panel needs to get rendered in the current update,
+ *         otherwise the encoded data and current estimate are reused
  * @current_limit: current limit for the whole framebuffer
  * @current_active: active estimated current usage by the framebuffer
  * @current_tmp: temporary current estimation prior to updating the screen
  * @current_max: max estimated current usage by the framebuffer
+ * @current_drive: sum of the led currents (excluding base current)
+ *                 at full global/panel brightness in mA * 255 * 255
  * @brightness: control the brightness of this specific panel
+ * @lut: per channel gamma curve fused with global and panel brightness
+ * @lut_brightness: the global brightness @lut got calculated for
+ * @lut_seq: the rgbled_fb.gamma_active_seq @lut got calculated for
+ * @lut16: the same as @lut in 8.8 fixed point
+ * @dithering: the panel shows fractional values, so needs further
+ *             updates to dither over time
  * @expose_all_led: expose all led via sysfs using led api
  * @of_node: reference to the device_node that initialized this panel
  */
@@ -200,6 +479,9 @@ struct rgbled_panel_info {
 
 	struct list_head	list;
 	u32			id;
+	u32			index;
+	u32			output;
+	u32			output_pixel;
 
 	const char		*compatible;
 	const char		*name;
@@ -239,17 +521,30 @@ struct rgbled_panel_info {
 				struct rgbled_coordinates *coord,
 				struct rgbled_pixel *pix);
 
+	/* precomputed vmem offsets of the panel pixel */
+	u32			*pixel_map;
+	bool			dirty;
+
 	/* current estimates */
 	u32			current_limit;
 	u32			current_active;
 	u32			current_tmp;
 	u32			current_max;
+	u64			current_drive;
 
 	/* the default brightness */
 	u8			brightness;
 
+	/* the transfer curves used for encoding */
+	u8			lut[3][RGBLED_GAMMA_SIZE];
+	u16			lut16[3][RGBLED_GAMMA_SIZE];
+	u8			lut_brightness;
+	u32			lut_seq;
+	bool			dithering;
+
 	/* expose all led also via sysfs */
 	bool			expose_all_led;
+	bool			hw_brightness;
 
 	struct device_node	*of_node;
 };
@@ -270,13 +565,40 @@ static inline void rgbled_get_pixel_value(struct rgbled_fb *rfb,
 	return panel->get_pixel_value(rfb, panel, coord, pix);
 }
 
+static inline size_t rgbled_pixel_size(struct rgbled_fb *rfb)
+{
+	if (rfb->bits_per_channel == 16)
+		return sizeof(struct rgbled_pixel16);
+	return sizeof(struct rgbled_pixel);
+}
+
 static inline struct rgbled_pixel *rgbled_get_raw_pixel(
 	struct rgbled_fb *rfb,
 	struct rgbled_coordinates *coord)
 {
-	return &rfb->vmem[coord->y * rfb->width + coord->x];
+	return &rfb->shadow[coord->y * rfb->width + coord->x];
+}
+
+/* bracket modifications of vmem from inside the kernel, so that the
+ * frame snapshot can detect them and retry - writers never block and
+ * may run concurrently (so this is a seqcount with a writer count)
+ */
+static inline void rgbled_vmem_write_begin(struct rgbled_fb *rfb)
+{
+	atomic_inc(&rfb->vmem_writers);
+	smp_mb__after_atomic();
 }
 
+static inline void rgbled_vmem_write_end(struct rgbled_fb *rfb)
+{
+	smp_mb__before_atomic();
+	atomic_inc(&rfb->vmem_gen);
+	atomic_dec(&rfb->vmem_writers);
+}
+
+/* pixel_map value for pixel that do not map into vmem */
+#define RGBLED_PIXEL_MAP_BLACK	(~0U)
+
 static inline void rgbled_get_pixel_coords(struct rgbled_fb *rfb,
 					   struct rgbled_panel_info *panel,
 					   int panel_pixel_num,
@@ -297,27 +619,268 @@ void rgbled_get_pixel_coords_meander(struct rgbled_fb *rfb,
 				     int pixel_num,
 				     struct rgbled_coordinates *coord);
 
+/**
+ * struct rgbled_platform_data - layout of a framebuffer without device-tree
+ * @panels: the panels in chain order with position, size and output set
+ *          (terminated by an entry without compatible)
+ * @current_limit: current limit for the whole framebuffer in mA
+ */
+struct rgbled_platform_data {
+	struct rgbled_panel_info *panels;
+	u32			current_limit;
+};
+
 /* allocation of the rgbled_framebuffer
  * making use of devres to release the allocated resources
+ * panels are the templates matched against the device-tree nodes,
+ * or without a device-tree the actual panels in chain order
+ * (terminated by an entry without compatible)
  */
 struct rgbled_fb *rgbled_alloc(struct device *dev,
 			       const char *name,
 			       struct rgbled_panel_info *panels);
+/* vzalloc released via devres - for the buffers of long chains */
+void *rgbled_devm_vzalloc(struct device *dev, size_t size);
+
 /* register a led-panel/strip */
 int rgbled_register_panel(struct rgbled_fb *rfb,
 			  struct rgbled_panel_info *panel);
 
+/* the number of pixel chained on a specific output */
+u32 rgbled_output_pixel(struct rgbled_fb *rfb, u32 output);
+
 /* finally register the rgbled_framebuffer */
 int rgbled_register(struct rgbled_fb *fb);
 
-/* scheduling a screen update for the framebuffer */
+/* report that frame seq got transmitted completely - from any context */
+void rgbled_frame_done(struct rgbled_fb *rfb, u32 seq);
+
+/* schedule a screen update for the next frame slot */
+void rgbled_schedule_frame(struct rgbled_fb *rfb);
+
 static inline void rgbled_schedule(struct fb_info *info)
 {
-	schedule_delayed_work(&info->deferred_work, 1);
+	rgbled_schedule_frame(info->par);
+}
+
+/* number of transmit buffers of a rgbled_spi_output:
+ * one on the wire, one queued and one getting filled
+ */
+#define RGBLED_SPI_BUFFERS	3
+
+/* the maximum segment of a frame transmitted as a single spi_transfer
+ * - the default dma segment size
+ */
+#define RGBLED_SPI_SEGMENT_MAX	65536
+
+struct rgbled_spi_output;
+
+/**
+ * struct rgbled_spi_buffer - a single transmit buffer of a spi output
+ * @out: the output this buffer belongs to
+ * @seq: the rgbled_fb.frame_seq of the frame in the buffer
+ * @data: the encoded frame
+ * @msg: the prepared spi_message (optimized once where the spi core
+ *       supports it)
+ * @xfers: the transfers of the message - one per segment of @data
+ */
+struct rgbled_spi_buffer {
+	struct rgbled_spi_output *out;
+	u32			seq;
+	void			*data;
+	struct spi_message	msg;
+	struct spi_transfer	*xfers;
+};
+
+/**
+ * struct rgbled_spi_output - asynchronous spi output for encoded frames
+ * @rfb: the framebuffer this output belongs to
+ * @list: entry in rgbled_fb.spi_outputs
+ * @spi: the spi device to transmit on
+ * @len: length of an encoded frame in bytes
+ * @segment: length of all but the last segment of a frame
+ * @segments: number of segments of a frame
+ * @lock: protects @active, @pending and @stopping
+ *        (also taken from the spi completion callback)
+ * @buffers: the transmit buffers
+ * @active: the buffer that is currently on the wire
+ * @pending: the buffer that gets transmitted when @active completes
+ * @fill: the buffer the next frame gets encoded into
+ * @last: the buffer submitted last
+ * @stopping: do not submit any further frames
+ * @idle: woken when there is no more buffer on the wire
+ * @frames_dropped: number of pending frames replaced by a newer frame
+ * @done_seq: the sequence number of the frame transmitted last
+ *
+ * the driver encodes right into the @fill buffer and submits it, which
+ * rotates the buffers, so the next frame gets encoded while this one is
+ * on the wire - panels that did not change get taken over from @last
+ */
+struct rgbled_spi_output {
+	struct rgbled_fb	*rfb;
+	struct list_head	list;
+	struct spi_device	*spi;
+	size_t			len;
+	size_t			segment;
+	int			segments;
+
+	spinlock_t		lock; /* protects active/pending */
+	struct rgbled_spi_buffer buffers[RGBLED_SPI_BUFFERS];
+	struct rgbled_spi_buffer *active;
+	struct rgbled_spi_buffer *pending;
+	struct rgbled_spi_buffer *fill;
+	struct rgbled_spi_buffer *last;
+	bool			stopping;
+	wait_queue_head_t	idle;
+
+	u32			frames_dropped;
+	u32			done_seq;
+};
+
+/* set up a spi output - making use of devres to wait for completion
+ * frames longer than the controller can transfer at once get split
+ * into segments at multiples of align (where a pause of the clock
+ * does not corrupt the protocol)
+ * init is the initial content of all transmit buffers (zeroed if NULL)
+ */
+int rgbled_spi_output_init(struct rgbled_spi_output *out,
+			   struct rgbled_fb *rfb,
+			   struct spi_device *spi,
+			   size_t len, size_t align,
+			   const void *init);
+
+/* the spi device of an output - output 0 is the device itself,
+ * the others are referenced via the spi-outputs property
+ */
+struct spi_device *rgbled_spi_output_device(struct rgbled_fb *rfb,
+					    struct spi_device *spi,
+					    u32 output);
+
+/* the transmit buffer the next frame gets encoded into
+ * - it belongs to the driver until it gets submitted
+ */
+static inline void *rgbled_spi_output_buffer(struct rgbled_spi_output *out)
+{
+	return out->fill->data;
 }
 
+/* the frame submitted last (NULL before the first one) */
+static inline const void *rgbled_spi_output_last(
+	struct rgbled_spi_output *out)
+{
+	return out->last ? out->last->data : NULL;
+}
+
+/* take over an unchanged range from the frame submitted last
+ * - for the panels that did not get encoded this time
+ */
+void rgbled_spi_output_keep(struct rgbled_spi_output *out,
+			    size_t offset, size_t len);
+
+/* submit the encoded frame for transmission without waiting for it
+ * must not be called concurrently - typically from finish_work
+ */
+void rgbled_spi_output_submit(struct rgbled_spi_output *out);
+
 /* internal functions used in several c-files - not exported */
 
+/* stop an output and wait for the frame on the wire to complete */
+void rgbled_spi_output_stop(struct rgbled_spi_output *out);
+
+/* record modified regions of vmem for the next update */
+void rgbled_damage_range(struct rgbled_fb *rfb, size_t offset, size_t len);
+void rgbled_damage_rect(struct rgbled_fb *rfb, u32 x, u32 y, u32 w, u32 h);
+void rgbled_damage_all(struct rgbled_fb *rfb);
+
+/* frame statistics */
+void rgbled_stat_add(struct rgbled_stat *stat, u64 ns);
+/* add the time since start to stat and return the current time */
+ktime_t rgbled_stat_stage(struct rgbled_stat *stat, ktime_t start);
+void rgbled_register_debugfs(struct rgbled_fb *rfb);
+void rgbled_unregister_debugfs(struct rgbled_fb *rfb);
+
+/* temporal dithering of 8.8 fixed point values */
+bool rgbled_dither(const u16 *in, u8 *residual, u8 *out, int count);
+
+/* the highest brightness that keeps the estimated current
+ * base + drive * brightness / 255^4 at or below limit (0 - no limit)
+ */
+u8 rgbled_limit_brightness(u8 brightness, u64 drive, u32 base, u32 limit);
+
+/* 3 times oversampled one-wire encoding (0b100/0b110 per bit) of count
+ * bytes of src into 3 * count bytes of dst (high, medium, low)
+ */
+extern const u8 rgbled_encode_3bit_table[256][3];
+void rgbled_encode_3bit(u8 *dst, const u8 *src, int count);
+
+/* vectorized 3 times oversampled one-wire encoding (0b100/0b110 per bit)
+ * of the leading bytes of src - returns the number of bytes encoded,
+ * the rest is left to the scalar code of the caller
+ */
+#if defined(CONFIG_KERNEL_MODE_NEON) || defined(CONFIG_X86)
+int rgbled_encode_3bit_simd(u8 *dst, const u8 *src, int count);
+#else
+static inline int rgbled_encode_3bit_simd(u8 *dst, const u8 *src, int count)
+{
+	return 0;
+}
+#endif
+
+/* an encoded ws2812 byte
+ * we present each bit as 3 bits (oversampling by a factor of 3)
+ *   zero is represented as 0b100
+ *   one is represented as 0b110
+ * so each byte is actually represented as 3 bytes, which are
+ * sent via spi as high, medium, low at 3* required HZ
+ */
+struct ws2812b_encoding {
+	u8 h, m, l;
+};
+
+/* an encoded ws2812 rgb-pixel */
+struct ws2812b_pixel {
+	struct ws2812b_encoding g, r, b;
+};
+
+/* a ws2812 frame of pixel leds: the encoded pixel followed by zeros,
+ * which keep the line low long enough to latch the data
+ */
+static inline size_t rgbled_ws2812_frame_len(u32 pixel)
+{
+	return pixel * sizeof(struct ws2812b_pixel) + 15;
+}
+
+/* the channels of count pixel in transmission order, dimmed by their
+ * alpha, into grb (3 * count bytes) and encoded from there into dst
+ */
+void rgbled_encode_ws2812(struct ws2812b_pixel *dst, u8 *grb,
+			  const struct rgbled_pixel *pix, int count);
+
+/* an encoded apa102 rgb-pixel - 0xe0 | the 5 bit current level first */
+struct apa102_pixel {
+	u8 brightness, b, g, r;
+};
+
+/* an apa102 frame of pixel leds: a start frame of zeros, the pixel
+ * and the trailing clocks that push the data through the chain
+ */
+static inline size_t rgbled_apa102_frame_len(u32 pixel)
+{
+	return (pixel + 1) * sizeof(struct apa102_pixel) + pixel / 8 + 1;
+}
+
+/* a frame with all leds off */
+void rgbled_apa102_frame_init(void *frame, u32 pixel);
+
+/* count pixel into their place in the frame (after the start frame) */
+void rgbled_encode_apa102(struct apa102_pixel *dst,
+			  const struct rgbled_pixel *pix, int count);
+
+/* the panel types of the drivers - in rgbled-fb-panels.c */
+extern struct rgbled_panel_info ws2812b_panels[];
+extern struct rgbled_panel_info ws2812_panels[];
+extern struct rgbled_panel_info apa102_panels[];
+
 /* register all panels that are defined in the devicetree */
 int rgbled_register_of(struct rgbled_fb *rfb);
 int rgbled_scan_panels_of(struct rgbled_fb *rfb,
@@ -0,0 +1,312 @@
+/*
+ *  linux/drivers/video/fb/rgbled-null.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  Frame buffer without any LEDs attached - the pixel just end up
+ *  in memory. This runs the whole core (panel layout, coordinate
+ *  mapping, current limiting, deferred io, sysfs and leds) without
+ *  any bus, so it can get profiled at any size on any machine.
+ *
+ *  Configured either via platform data (struct rgbled_platform_data)
+ *  or via module parameters.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+
+#include "rgbled-fb.h"
+
+#define DEVICE_NAME "rgbled-null"
+
+/* the maximum number of devices created from the module parameters */
+#define RGBLED_NULL_MAX_DEVICES	8
+
+static unsigned int devices = 1;
+module_param(devices, uint, 0444);
+MODULE_PARM_DESC(devices,
+		 "number of framebuffers created from the parameters (default 1)");
+
+static unsigned int width = 32;
+module_param(width, uint, 0444);
+MODULE_PARM_DESC(width, "width of a panel (default 32)");
+
+static unsigned int height = 8;
+module_param(height, uint, 0444);
+MODULE_PARM_DESC(height, "height of a panel (default 8)");
+
+static unsigned int panels = 1;
+module_param(panels, uint, 0444);
+MODULE_PARM_DESC(panels, "number of panels side by side (default 1)");
+
+static unsigned int outputs = 1;
+module_param(outputs, uint, 0444);
+MODULE_PARM_DESC(outputs,
+		 "number of outputs the panels get distributed over (default 1)");
+
+static bool meander = true;
+module_param(meander, bool, 0444);
+MODULE_PARM_DESC(meander, "panels are wired in meander (default 1)");
+
+static bool layout_yx;
+module_param(layout_yx, bool, 0444);
+MODULE_PARM_DESC(layout_yx, "panels are wired column by column (default 0)");
+
+static unsigned int current_limit;
+module_param(current_limit, uint, 0444);
+MODULE_PARM_DESC(current_limit, "current limit in mA (default 0 - none)");
+
+static bool batched = true;
+module_param(batched, bool, 0444);
+MODULE_PARM_DESC(batched,
+		 "hand over the pixel of a panel in one call (default 1)");
+
+static bool expose_all_led;
+module_param(expose_all_led, bool, 0444);
+MODULE_PARM_DESC(expose_all_led, "expose all leds via the led api (default 0)");
+
+/**
+ * struct rgbled_null_output - the memory an output gets rendered into
+ * @pixel: the pixel in chain order
+ * @blob: debugfs view of @pixel
+ */
+struct rgbled_null_output {
+	struct rgbled_pixel	*pixel;
+	struct debugfs_blob_wrapper blob;
+};
+
+struct rgbled_null_data {
+	struct rgbled_fb	*rgbled_fb;
+	struct rgbled_null_output *outputs;
+	struct dentry		*debugfs;
+};
+
+static void rgbled_null_set_pixel_value(struct rgbled_fb *rfb,
+					struct rgbled_panel_info *panel,
+					int pixel_num,
+					struct rgbled_pixel *pix)
+{
+	struct rgbled_null_data *bn = rfb->par;
+
+	bn->outputs[panel->output].pixel[pixel_num] = *pix;
+}
+
+static void rgbled_null_set_pixel_values(struct rgbled_fb *rfb,
+					 struct rgbled_panel_info *panel,
+					 int pixel_num,
+					 const struct rgbled_pixel *pix,
+					 int count)
+{
+	struct rgbled_null_data *bn = rfb->par;
+
+	memcpy(&bn->outputs[panel->output].pixel[pixel_num], pix,
+	       count * sizeof(*pix));
+}
+
+static void rgbled_null_finish_work(struct rgbled_fb *rfb)
+{
+	/* nothing to transmit, so the frame is done right away */
+	rgbled_frame_done(rfb, rfb->frame_seq);
+}
+
+/* build the layout from the module parameters */
+static struct rgbled_panel_info *rgbled_null_param_panels(
+	struct device *dev)
+{
+	struct rgbled_panel_info *p;
+	int i;
+
+	if ((!width) || (!height) || (!panels) || (!outputs)) {
+		dev_err(dev, "width, height, panels and outputs need to be set\n");
+		return ERR_PTR(-EINVAL);
+	}
+
+	/* including the terminating entry */
+	p = devm_kcalloc(dev, panels + 1, sizeof(*p), GFP_KERNEL);
+	if (!p)
+		return ERR_PTR(-ENOMEM);
+
+	for (i = 0; i < panels; i++) {
+		p[i].compatible = DEVICE_NAME ",panel";
+		p[i].x = i * width;
+		p[i].width = width;
+		p[i].height = height;
+		p[i].output = i % outputs;
+		p[i].layout_yx = layout_yx;
+		if (meander)
+			p[i].get_pixel_coords =
+				rgbled_get_pixel_coords_meander;
+	}
+
+	return p;
+}
+
+static void rgbled_null_debugfs(struct rgbled_null_data *bn,
+				struct device *dev)
+{
+	char name[16];
+	int i;
+
+	bn->debugfs = debugfs_create_dir(dev_name(dev), NULL);
+	if (IS_ERR_OR_NULL(bn->debugfs)) {
+		bn->debugfs = NULL;
+		return;
+	}
+
+	for (i = 0; i < bn->rgbled_fb->outputs; i++) {
+		snprintf(name, sizeof(name), "output%i", i);
+		debugfs_create_blob(name, 0444, bn->debugfs,
+				    &bn->outputs[i].blob);
+	}
+}
+
+static int rgbled_null_probe(struct platform_device *pdev)
+{
+	struct rgbled_platform_data *pdata = dev_get_platdata(&pdev->dev);
+	struct device *dev = &pdev->dev;
+	struct rgbled_panel_info *layout;
+	struct rgbled_null_data *bn;
+	struct rgbled_fb *rfb;
+	size_t len;
+	int i, err;
+
+	/* the panels of the framebuffer */
+	layout = pdata ? pdata->panels : rgbled_null_param_panels(dev);
+	if (IS_ERR(layout))
+		return PTR_ERR(layout);
+
+	/* allocate our buffer */
+	bn = devm_kzalloc(dev, sizeof(*bn), GFP_KERNEL);
+	if (!bn)
+		return -ENOMEM;
+
+	rfb = rgbled_alloc(dev, DEVICE_NAME, layout);
+	bn->rgbled_fb = rfb;
+	if (!rfb)
+		return -ENOMEM;
+	if (IS_ERR(rfb))
+		return PTR_ERR(rfb);
+
+	/* the memory of the individual outputs */
+	bn->outputs = devm_kcalloc(dev, rfb->outputs, sizeof(*bn->outputs),
+				   GFP_KERNEL);
+	if (!bn->outputs)
+		return -ENOMEM;
+	for (i = 0; i < rfb->outputs; i++) {
+		len = rgbled_output_pixel(rfb, i) * sizeof(struct rgbled_pixel);
+		bn->outputs[i].pixel = devm_kzalloc(dev, len, GFP_KERNEL);
+		if (!bn->outputs[i].pixel)
+			return -ENOMEM;
+		bn->outputs[i].blob.data = bn->outputs[i].pixel;
+		bn->outputs[i].blob.size = len;
+	}
+
+	/* setting up deferred work */
+	if (batched)
+		rfb->set_pixel_values = rgbled_null_set_pixel_values;
+	else
+		rfb->set_pixel_value = rgbled_null_set_pixel_value;
+	rfb->finish_work = rgbled_null_finish_work;
+
+	/* the currents of a ws2812b, so that limiting has something to do */
+	rfb->led_current_max_red = 17;
+	rfb->led_current_max_green = 17;
+	rfb->led_current_max_blue = 17;
+	rfb->led_current_base = 1;
+	rfb->current_limit = pdata ? pdata->current_limit : current_limit;
+	rfb->expose_all_led = expose_all_led;
+
+	/* set the reverse pointer */
+	rfb->par = bn;
+	platform_set_drvdata(pdev, bn);
+
+	/* and register */
+	err = rgbled_register(rfb);
+	if (err)
+		return err;
+
+	rgbled_null_debugfs(bn, dev);
+
+	return 0;
+}
+
+static int rgbled_null_remove(struct platform_device *pdev)
+{
+	struct rgbled_null_data *bn = platform_get_drvdata(pdev);
+
+	debugfs_remove_recursive(bn->debugfs);
+
+	return 0;
+}
+
+static struct platform_driver rgbled_null_driver = {
+	.driver = {
+		.name = DEVICE_NAME,
+		.owner = THIS_MODULE,
+	},
+	.probe = rgbled_null_probe,
+	.remove = rgbled_null_remove,
+};
+
+static struct platform_device *rgbled_null_devices[RGBLED_NULL_MAX_DEVICES];
+
+static void rgbled_null_unregister_devices(void)
+{
+	int i;
+
+	for (i = 0; i < RGBLED_NULL_MAX_DEVICES; i++) {
+		if (rgbled_null_devices[i])
+			platform_device_unregister(rgbled_null_devices[i]);
+		rgbled_null_devices[i] = NULL;
+	}
+}
+
+static int __init rgbled_null_init(void)
+{
+	struct platform_device *pdev;
+	int i, err;
+
+	err = platform_driver_register(&rgbled_null_driver);
+	if (err)
+		return err;
+
+	/* and the devices configured by the module parameters */
+	for (i = 0; i < min_t(unsigned int, devices,
+			      RGBLED_NULL_MAX_DEVICES); i++) {
+		pdev = platform_device_register_simple(DEVICE_NAME, i,
+						       NULL, 0);
+		if (IS_ERR(pdev)) {
+			err = PTR_ERR(pdev);
+			rgbled_null_unregister_devices();
+			platform_driver_unregister(&rgbled_null_driver);
+			return err;
+		}
+		rgbled_null_devices[i] = pdev;
+	}
+
+	return 0;
+}
+module_init(rgbled_null_init);
+
+static void __exit rgbled_null_exit(void)
+{
+	rgbled_null_unregister_devices();
+	platform_driver_unregister(&rgbled_null_driver);
+}
+module_exit(rgbled_null_exit);
+
+MODULE_AUTHOR("Martin Sperl <kernel@martin.sperl.org>");
+MODULE_DESCRIPTION("RGB LED FB-driver without LEDs for profiling");
+MODULE_LICENSE("GPL");
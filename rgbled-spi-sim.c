@@ -0,0 +1,525 @@
+/*
+ *  linux/drivers/video/fb/rgbled-spi-sim.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  simulated SPI master for testing the rgbled framebuffers
+ *  without any hardware attached.
+ *
+ *  Every transfer takes the time it would need on the wire
+ *  (len * 8 bits at the transfer speed) before it completes,
+ *  so frame pacing and the overlap of rendering and transmission
+ *  behave like on real hardware.
+ *  Every transmitted message (a frame) gets recorded into a ring
+ *  and the data of the last one per chip-select is kept, both
+ *  readable via debugfs.
+ *
+ *  The buses get described in the device-tree, or without one get
+ *  created from the module parameters - together with a framebuffer
+ *  on chip-select 0 (see the spi_device_id tables of the led drivers).
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <linux/crc32.h>
+#include <linux/debugfs.h>
+#include <linux/hrtimer.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/seq_file.h>
+#include <linux/spi/spi.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+
+#include "rgbled-fb.h"
+
+#define DEVICE_NAME "rgbled-spi-sim"
+
+/* number of frames kept in the ring */
+#define RGBLED_SPI_SIM_RECORDS	64
+
+/* the maximum number of buses created from the module parameters */
+#define RGBLED_SPI_SIM_MAX_DEVICES	8
+
+static unsigned int record_size = 65536;
+module_param(record_size, uint, 0444);
+MODULE_PARM_DESC(record_size,
+		 "bytes of the last frame kept per chip-select (default 65536)");
+
+static unsigned int devices;
+module_param(devices, uint, 0444);
+MODULE_PARM_DESC(devices,
+		 "number of buses created without device-tree (default 0)");
+
+static char *client;
+module_param(client, charp, 0444);
+MODULE_PARM_DESC(client,
+		 "led driver added on chip-select 0 of those buses: ws2812b, ws2812 or apa102 (default none)");
+
+static unsigned int speed_hz = 2400000;
+module_param(speed_hz, uint, 0444);
+MODULE_PARM_DESC(speed_hz, "spi speed of the client (default 2400000)");
+
+static unsigned int width = 32;
+module_param(width, uint, 0444);
+MODULE_PARM_DESC(width, "width of a panel of the client (default 32)");
+
+static unsigned int height = 8;
+module_param(height, uint, 0444);
+MODULE_PARM_DESC(height, "height of a panel of the client (default 8)");
+
+static unsigned int panels = 1;
+module_param(panels, uint, 0444);
+MODULE_PARM_DESC(panels, "number of panels side by side (default 1)");
+
+static bool meander = true;
+module_param(meander, bool, 0444);
+MODULE_PARM_DESC(meander, "panels are wired in meander (default 1)");
+
+static bool layout_yx;
+module_param(layout_yx, bool, 0444);
+MODULE_PARM_DESC(layout_yx, "panels are wired column by column (default 0)");
+
+/**
+ * struct rgbled_spi_sim_record - a single transmitted frame
+ * @start: the time the first transfer started
+ * @end: the time the last transfer completed
+ * @wire_ns: the time the frame took on the wire
+ * @len: the length of the frame in bytes
+ * @speed_hz: the speed of the last transfer
+ * @crc: crc32 of the transmitted data
+ * @cs: the chip-select
+ */
+struct rgbled_spi_sim_record {
+	ktime_t			start;
+	ktime_t			end;
+	u64			wire_ns;
+	u32			len;
+	u32			speed_hz;
+	u32			crc;
+	u8			cs;
+};
+
+/**
+ * struct rgbled_spi_sim_cs - the last frame transmitted on a chip-select
+ * @data: the data (up to record_size bytes)
+ * @blob: debugfs view of @data
+ */
+struct rgbled_spi_sim_cs {
+	void			*data;
+	struct debugfs_blob_wrapper blob;
+};
+
+/**
+ * struct rgbled_spi_sim - the simulated master
+ * @master: the spi master
+ * @timer: completes the transfer on the wire
+ * @lock: protects the records (also taken from the timer)
+ * @records: ring of the last RGBLED_SPI_SIM_RECORDS frames
+ * @record_count: number of frames recorded in total
+ * @record: the frame currently on the wire
+ * @last_xfer: the transfer on the wire is the last of its message
+ * @cs: per chip-select last frames
+ * @num_cs: number of chip-selects
+ * @debugfs: the debugfs directory
+ * @pdata: layout of the client created from the module parameters
+ *
+ * allocated separately from @master, as the master is gone
+ * by the time the devres resources get released
+ */
+struct rgbled_spi_sim {
+	struct spi_master	*master;
+	struct hrtimer		timer;
+
+	spinlock_t		lock; /* protects the records */
+	struct rgbled_spi_sim_record records[RGBLED_SPI_SIM_RECORDS];
+	u64			record_count;
+	struct rgbled_spi_sim_record *record;
+	bool			last_xfer;
+
+	struct rgbled_spi_sim_cs *cs;
+	u32			num_cs;
+	struct dentry		*debugfs;
+	struct rgbled_platform_data pdata;
+};
+
+static int rgbled_spi_sim_transfer_one(struct spi_master *master,
+				       struct spi_device *spi,
+				       struct spi_transfer *xfer)
+{
+	struct rgbled_spi_sim *sim = spi_master_get_devdata(master);
+	struct spi_message *msg = master->cur_msg;
+	struct rgbled_spi_sim_cs *cs = &sim->cs[spi->chip_select];
+	struct rgbled_spi_sim_record *rec;
+	unsigned long flags;
+	u64 wire_ns = 0;
+	size_t copy;
+
+	if (xfer->speed_hz)
+		wire_ns = div_u64((u64)xfer->len * 8 * NSEC_PER_SEC,
+				  xfer->speed_hz);
+
+	spin_lock_irqsave(&sim->lock, flags);
+
+	/* a new message starts a new record */
+	if (xfer->transfer_list.prev == &msg->transfers) {
+		rec = &sim->records[sim->record_count %
+				    RGBLED_SPI_SIM_RECORDS];
+		memset(rec, 0, sizeof(*rec));
+		rec->start = ktime_get();
+		rec->cs = spi->chip_select;
+		sim->record = rec;
+		sim->record_count++;
+		cs->blob.size = 0;
+	}
+	rec = sim->record;
+
+	/* keep what got transmitted */
+	if (xfer->tx_buf) {
+		rec->crc = crc32_le(rec->crc, xfer->tx_buf, xfer->len);
+		if (rec->len < record_size) {
+			copy = min_t(size_t, xfer->len,
+				     record_size - rec->len);
+			memcpy(cs->data + rec->len, xfer->tx_buf, copy);
+			cs->blob.size = rec->len + copy;
+		}
+	}
+	rec->len += xfer->len;
+	rec->speed_hz = xfer->speed_hz;
+	rec->wire_ns += wire_ns;
+	sim->last_xfer = xfer->transfer_list.next == &msg->transfers;
+
+	spin_unlock_irqrestore(&sim->lock, flags);
+
+	/* and complete when it would have left the wire */
+	hrtimer_start(&sim->timer, ns_to_ktime(wire_ns), HRTIMER_MODE_REL);
+
+	return 1;
+}
+
+static enum hrtimer_restart rgbled_spi_sim_timer(struct hrtimer *timer)
+{
+	struct rgbled_spi_sim *sim = container_of(timer, struct rgbled_spi_sim,
+						  timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&sim->lock, flags);
+	if (sim->last_xfer)
+		sim->record->end = ktime_get();
+	spin_unlock_irqrestore(&sim->lock, flags);
+
+	spi_finalize_current_transfer(sim->master);
+
+	return HRTIMER_NORESTART;
+}
+
+static int rgbled_spi_sim_frames_show(struct seq_file *m, void *v)
+{
+	struct rgbled_spi_sim *sim = m->private;
+	struct rgbled_spi_sim_record rec;
+	unsigned long flags;
+	ktime_t last_end = 0;
+	u64 i, count;
+
+	seq_printf(m, "%10s %2s %8s %9s %20s %12s %12s %12s %8s\n",
+		   "frame", "cs", "len", "speed_hz", "start_ns",
+		   "duration_ns", "wire_ns", "gap_ns", "crc32");
+
+	spin_lock_irqsave(&sim->lock, flags);
+	count = sim->record_count;
+	spin_unlock_irqrestore(&sim->lock, flags);
+
+	/* oldest first - the gap is the idle time of the bus before */
+	for (i = count > RGBLED_SPI_SIM_RECORDS ?
+		     count - RGBLED_SPI_SIM_RECORDS : 0; i < count; i++) {
+		spin_lock_irqsave(&sim->lock, flags);
+		rec = sim->records[i % RGBLED_SPI_SIM_RECORDS];
+		spin_unlock_irqrestore(&sim->lock, flags);
+
+		/* still on the wire */
+		if (!ktime_to_ns(rec.end))
+			break;
+
+		seq_printf(m,
+			   "%10llu %2u %8u %9u %20lld %12lld %12llu %12lld %08x\n",
+			   i, rec.cs, rec.len, rec.speed_hz,
+			   ktime_to_ns(rec.start),
+			   ktime_to_ns(ktime_sub(rec.end, rec.start)),
+			   rec.wire_ns,
+			   ktime_to_ns(last_end) ?
+			   ktime_to_ns(ktime_sub(rec.start, last_end)) : 0,
+			   rec.crc);
+		last_end = rec.end;
+	}
+
+	return 0;
+}
+
+static int rgbled_spi_sim_frames_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rgbled_spi_sim_frames_show,
+			   inode->i_private);
+}
+
+static const struct file_operations rgbled_spi_sim_frames_fops = {
+	.owner		= THIS_MODULE,
+	.open		= rgbled_spi_sim_frames_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void rgbled_spi_sim_debugfs(struct rgbled_spi_sim *sim)
+{
+	char name[32];
+	int i;
+
+	snprintf(name, sizeof(name), "%s.%i", DEVICE_NAME,
+		 sim->master->bus_num);
+	sim->debugfs = debugfs_create_dir(name, NULL);
+	if (IS_ERR_OR_NULL(sim->debugfs)) {
+		sim->debugfs = NULL;
+		return;
+	}
+
+	debugfs_create_file("frames", 0444, sim->debugfs, sim,
+			    &rgbled_spi_sim_frames_fops);
+	for (i = 0; i < sim->num_cs; i++) {
+		snprintf(name, sizeof(name), "last-frame-cs%i", i);
+		debugfs_create_blob(name, 0444, sim->debugfs,
+				    &sim->cs[i].blob);
+	}
+}
+
+/* runs after the master got unregistered, so nothing is on the wire */
+static void rgbled_spi_sim_release(struct device *dev, void *res)
+{
+	struct rgbled_spi_sim *sim = *(struct rgbled_spi_sim **)res;
+	int i;
+
+	hrtimer_cancel(&sim->timer);
+	debugfs_remove_recursive(sim->debugfs);
+	for (i = 0; i < sim->num_cs; i++)
+		vfree(sim->cs[i].data);
+}
+
+/* build the layout of the client from the module parameters */
+static int rgbled_spi_sim_param_panels(struct rgbled_spi_sim *sim,
+				       struct device *dev)
+{
+	struct rgbled_panel_info *p;
+	int i;
+
+	if ((!width) || (!height) || (!panels)) {
+		dev_err(dev, "width, height and panels need to be set\n");
+		return -EINVAL;
+	}
+
+	/* including the terminating entry */
+	p = devm_kcalloc(dev, panels + 1, sizeof(*p), GFP_KERNEL);
+	if (!p)
+		return -ENOMEM;
+
+	for (i = 0; i < panels; i++) {
+		p[i].compatible = DEVICE_NAME ",panel";
+		p[i].x = i * width;
+		p[i].width = width;
+		p[i].height = height;
+		p[i].layout_yx = layout_yx;
+		if (meander)
+			p[i].get_pixel_coords =
+				rgbled_get_pixel_coords_meander;
+	}
+	sim->pdata.panels = p;
+
+	return 0;
+}
+
+/* the framebuffer on chip-select 0 - the master removes it again */
+static int rgbled_spi_sim_add_client(struct rgbled_spi_sim *sim,
+				     struct device *dev)
+{
+	struct spi_board_info info = {
+		.max_speed_hz	= speed_hz,
+		.chip_select	= 0,
+		.platform_data	= &sim->pdata,
+	};
+
+	strscpy(info.modalias, client, sizeof(info.modalias));
+	if (!spi_new_device(sim->master, &info)) {
+		dev_err(dev, "could not add %s on chip-select 0\n", client);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+static int rgbled_spi_sim_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct spi_master *master;
+	struct rgbled_spi_sim *sim;
+	struct rgbled_spi_sim **ptr;
+	u32 num_cs = 4;
+	int i, err;
+
+	of_property_read_u32(dev->of_node, "num-cs", &num_cs);
+	if ((!num_cs) || (num_cs > 256)) {
+		dev_err(dev, "num-cs of %u is not supported\n", num_cs);
+		return -EINVAL;
+	}
+
+	sim = devm_kzalloc(dev, sizeof(*sim), GFP_KERNEL);
+	if (!sim)
+		return -ENOMEM;
+	sim->num_cs = num_cs;
+
+	/* the layout of the client needs to outlive the master */
+	if ((!dev->of_node) && (client)) {
+		err = rgbled_spi_sim_param_panels(sim, dev);
+		if (err)
+			return err;
+	}
+
+	/* the last frame per chip-select */
+	sim->cs = devm_kcalloc(dev, num_cs, sizeof(*sim->cs), GFP_KERNEL);
+	if (!sim->cs)
+		return -ENOMEM;
+
+	master = spi_alloc_master(dev, 0);
+	if (!master)
+		return -ENOMEM;
+	platform_set_drvdata(pdev, master);
+	spi_master_set_devdata(master, sim);
+	sim->master = master;
+	spin_lock_init(&sim->lock);
+	hrtimer_init(&sim->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	sim->timer.function = rgbled_spi_sim_timer;
+
+	master->dev.of_node = dev->of_node;
+	master->bus_num = -1;
+	master->num_chipselect = num_cs;
+	master->mode_bits = SPI_CPOL | SPI_CPHA | SPI_CS_HIGH;
+	master->bits_per_word_mask = SPI_BPW_MASK(8);
+	master->flags = SPI_MASTER_NO_RX;
+	master->transfer_one = rgbled_spi_sim_transfer_one;
+
+	ptr = devres_alloc(rgbled_spi_sim_release, sizeof(*ptr), GFP_KERNEL);
+	if (!ptr) {
+		err = -ENOMEM;
+		goto err_put;
+	}
+	*ptr = sim;
+	for (i = 0; i < num_cs; i++) {
+		sim->cs[i].data = vzalloc(max(record_size, 1U));
+		if (!sim->cs[i].data) {
+			err = -ENOMEM;
+			goto err_free;
+		}
+		sim->cs[i].blob.data = sim->cs[i].data;
+	}
+	/* released after the master got unregistered */
+	devres_add(dev, ptr);
+
+	err = devm_spi_register_master(dev, master);
+	if (err) {
+		dev_err(dev, "could not register spi master: %i\n", err);
+		goto err_put;
+	}
+
+	rgbled_spi_sim_debugfs(sim);
+
+	dev_info(dev, "simulated spi bus %i with %u chip-selects\n",
+		 master->bus_num, num_cs);
+
+	if (sim->pdata.panels)
+		return rgbled_spi_sim_add_client(sim, dev);
+
+	return 0;
+
+err_free:
+	for (i = 0; i < num_cs; i++)
+		vfree(sim->cs[i].data);
+	devres_free(ptr);
+err_put:
+	spi_master_put(master);
+	return err;
+}
+
+static const struct of_device_id rgbled_spi_sim_of_match[] = {
+	{ .compatible = "rgbled,spi-sim" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, rgbled_spi_sim_of_match);
+
+static struct platform_driver rgbled_spi_sim_driver = {
+	.driver = {
+		.name = DEVICE_NAME,
+		.owner = THIS_MODULE,
+		.of_match_table = rgbled_spi_sim_of_match,
+	},
+	.probe = rgbled_spi_sim_probe,
+};
+
+static struct platform_device *
+	rgbled_spi_sim_devices[RGBLED_SPI_SIM_MAX_DEVICES];
+
+static void rgbled_spi_sim_unregister_devices(void)
+{
+	int i;
+
+	for (i = 0; i < RGBLED_SPI_SIM_MAX_DEVICES; i++) {
+		if (rgbled_spi_sim_devices[i])
+			platform_device_unregister(rgbled_spi_sim_devices[i]);
+		rgbled_spi_sim_devices[i] = NULL;
+	}
+}
+
+static int __init rgbled_spi_sim_init(void)
+{
+	struct platform_device *pdev;
+	int i, err;
+
+	err = platform_driver_register(&rgbled_spi_sim_driver);
+	if (err)
+		return err;
+
+	/* and the buses configured by the module parameters */
+	for (i = 0; i < min_t(unsigned int, devices,
+			      RGBLED_SPI_SIM_MAX_DEVICES); i++) {
+		pdev = platform_device_register_simple(DEVICE_NAME, i,
+						       NULL, 0);
+		if (IS_ERR(pdev)) {
+			err = PTR_ERR(pdev);
+			rgbled_spi_sim_unregister_devices();
+			platform_driver_unregister(&rgbled_spi_sim_driver);
+			return err;
+		}
+		rgbled_spi_sim_devices[i] = pdev;
+	}
+
+	return 0;
+}
+module_init(rgbled_spi_sim_init);
+
+static void __exit rgbled_spi_sim_exit(void)
+{
+	rgbled_spi_sim_unregister_devices();
+	platform_driver_unregister(&rgbled_spi_sim_driver);
+}
+module_exit(rgbled_spi_sim_exit);
+
+MODULE_AUTHOR("Martin Sperl <kernel@martin.sperl.org>");
+MODULE_DESCRIPTION("simulated SPI master for RGB LED FB-drivers");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,227 @@
+/*
+ *  tools/rgbled-bench.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  benchmark of the coordinate mapping and the encoders of the core
+ *  in userspace - built against the kernel api shim in tools/shim
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rgbled-chain.h"
+
+/**
+ * struct bench - the buffers of a single layout
+ * @chain: the layout
+ * @screen: the screen - random pixel, so the encoders can not shortcut
+ * @leds: the leds in chain order
+ * @grb: the ws2812 channels in transmission order
+ * @ws2812b: the encoded ws2812b frame
+ * @apa102: the encoded apa102 frame
+ */
+struct bench {
+	struct rgbled_chain chain;
+	struct rgbled_pixel *screen;
+	struct rgbled_pixel *leds;
+	u8 *grb;
+	struct ws2812b_pixel *ws2812b;
+	struct apa102_pixel *apa102;
+};
+
+enum bench_stage {
+	bench_map,
+	bench_gather,
+	bench_ws2812b,
+	bench_apa102,
+	bench_stages
+};
+
+static const char * const bench_stage_names[] = {
+	[bench_map]	= "map",
+	[bench_gather]	= "gather",
+	[bench_ws2812b]	= "ws2812b",
+	[bench_apa102]	= "apa102",
+};
+
+static int64_t bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void bench_run_stage(struct bench *b, enum bench_stage stage)
+{
+	switch (stage) {
+	case bench_map:
+		rgbled_chain_map(&b->chain);
+		break;
+	case bench_gather:
+		rgbled_chain_gather(&b->chain, b->screen, b->leds);
+		break;
+	case bench_ws2812b:
+		rgbled_encode_ws2812(b->ws2812b, b->grb, b->leds,
+				     b->chain.pixel);
+		break;
+	case bench_apa102:
+		/* the first pixel follows the start frame */
+		rgbled_encode_apa102(b->apa102 + 1, b->leds, b->chain.pixel);
+		break;
+	default:
+		break;
+	}
+}
+
+/* ns per frame - repeated for at least min_ns */
+static double bench_stage(struct bench *b, enum bench_stage stage,
+			  int64_t min_ns)
+{
+	int64_t start, ns;
+	unsigned long rounds = 0;
+
+	/* warm up the caches */
+	bench_run_stage(b, stage);
+
+	start = bench_now();
+	do {
+		bench_run_stage(b, stage);
+		rounds++;
+		ns = bench_now() - start;
+	} while (ns < min_ns);
+
+	return (double)ns / rounds;
+}
+
+static int bench_init(struct bench *b, const char *layout)
+{
+	uint32_t state = 1;
+	u32 i;
+
+	memset(b, 0, sizeof(*b));
+	if (rgbled_chain_init(&b->chain, layout))
+		return -1;
+
+	b->screen = malloc(b->chain.width * b->chain.height *
+			   sizeof(*b->screen));
+	b->leds = malloc(b->chain.pixel * sizeof(*b->leds));
+	b->grb = malloc(b->chain.pixel * 3);
+	b->ws2812b = malloc(b->chain.pixel * sizeof(*b->ws2812b));
+	b->apa102 = malloc(rgbled_apa102_frame_len(b->chain.pixel));
+	if (!b->screen || !b->leds || !b->grb || !b->ws2812b || !b->apa102) {
+		fprintf(stderr, "out of memory\n");
+		return -1;
+	}
+
+	/* deterministic, so runs can be compared */
+	for (i = 0; i < b->chain.width * b->chain.height; i++) {
+		state = state * 1664525 + 1013904223;
+		memcpy(&b->screen[i], &state, sizeof(b->screen[i]));
+	}
+	rgbled_apa102_frame_init(b->apa102, b->chain.pixel);
+
+	return 0;
+}
+
+static void bench_free(struct bench *b)
+{
+	free(b->apa102);
+	free(b->ws2812b);
+	free(b->grb);
+	free(b->leds);
+	free(b->screen);
+	rgbled_chain_free(&b->chain);
+}
+
+static void bench_report(const char *layout, u32 leds, const char *stage,
+			 double ns)
+{
+	printf("%-8s %6u  %-16s %8.2f %10.0f\n",
+	       layout, leds, stage, ns / leds, 1e9 / ns);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] [layout...]\n"
+		"  -t MS     minimum time per measurement (default 200)\n"
+		"\n"
+		"layout is one of the standard layouts (default all but apa102):\n"
+		"  8x8       a single 8x8 meander matrix\n"
+		"  32x8      four 32x8 matrices in layout-y-x as 32x32\n"
+		"  strip     a strip of 10000 leds\n"
+		"  apa102    an apa102 strip of 300 leds\n"
+		"or compatible[:width][@panels] of any panel type\n", prog);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	static const char * const layouts[] = { "8x8", "32x8", "strip" };
+	const char * const *names = layouts;
+	int count = ARRAY_SIZE(layouts);
+	double ns[bench_stages];
+	int64_t min_ns = 200000000;
+	struct bench b;
+	int opt, i, s;
+
+	while ((opt = getopt(argc, argv, "t:")) != -1) {
+		switch (opt) {
+		case 't':
+			min_ns = strtoll(optarg, NULL, 0) * 1000000;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind < argc) {
+		names = (const char * const *)&argv[optind];
+		count = argc - optind;
+	}
+
+	/* the vectorized encoder gets used as in the kernel */
+#ifdef CONFIG_X86
+	printf("ws2812 encoder: %s\n",
+	       __builtin_cpu_supports("ssse3") ? "ssse3" : "table");
+#else
+	printf("ws2812 encoder: table\n");
+#endif
+	printf("%-8s %6s  %-16s %8s %10s\n",
+	       "layout", "leds", "stage", "ns/led", "fps");
+
+	for (i = 0; i < count; i++) {
+		if (bench_init(&b, names[i]))
+			return 1;
+
+		for (s = 0; s < bench_stages; s++) {
+			ns[s] = bench_stage(&b, s, min_ns);
+			bench_report(names[i], b.chain.pixel,
+				     bench_stage_names[s], ns[s]);
+		}
+		/* a whole frame: the map is built at registration only */
+		bench_report(names[i], b.chain.pixel, "frame ws2812b",
+			     ns[bench_gather] + ns[bench_ws2812b]);
+		bench_report(names[i], b.chain.pixel, "frame apa102",
+			     ns[bench_gather] + ns[bench_apa102]);
+
+		bench_free(&b);
+	}
+
+	return 0;
+}
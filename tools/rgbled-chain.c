@@ -0,0 +1,215 @@
+/*
+ *  tools/rgbled-chain.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  a led chain laid out in userspace with the panel types, coordinate
+ *  mapping and encoders of the core - no kernel or spi bus involved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rgbled-chain.h"
+
+/* the standard layouts of the benchmark and the golden frames */
+static const struct {
+	const char *name;
+	const char *layout;
+} rgbled_chain_layouts[] = {
+	{ "8x8",	"adafruit,neopixel,matrix,8x8" },
+	{ "32x8",	"adafruit,neopixel,matrix,32x8@4" },
+	{ "strip",	"worldsemi,ws2812b,strip:10000" },
+	{ "apa102",	"shiji-led,apa102,strip,60:300" },
+};
+
+static const struct rgbled_panel_info *rgbled_chain_type(
+	const char *name, size_t len, enum rgbled_chain_encoding *encoding)
+{
+	static const struct {
+		struct rgbled_panel_info *panels;
+		enum rgbled_chain_encoding encoding;
+	} tables[] = {
+		{ ws2812b_panels, rgbled_chain_ws2812 },
+		{ ws2812_panels, rgbled_chain_ws2812 },
+		{ apa102_panels, rgbled_chain_apa102 },
+	};
+	const struct rgbled_panel_info *type;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(tables); i++) {
+		for (type = tables[i].panels; type->compatible; type++) {
+			if ((strlen(type->compatible) == len) &&
+			    !strncmp(type->compatible, name, len)) {
+				*encoding = tables[i].encoding;
+				return type;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+int rgbled_chain_init(struct rgbled_chain *chain, const char *layout)
+{
+	const struct rgbled_panel_info *type;
+	struct rgbled_panel_info *panel;
+	unsigned long width = 0, panels = 1;
+	const char *spec = layout;
+	char *end;
+	size_t len, i;
+	int c;
+
+	memset(chain, 0, sizeof(*chain));
+	chain->layout = layout;
+	for (i = 0; i < ARRAY_SIZE(rgbled_chain_layouts); i++)
+		if (!strcmp(layout, rgbled_chain_layouts[i].name))
+			spec = rgbled_chain_layouts[i].layout;
+
+	/* compatible[:width][@panels] */
+	len = strcspn(spec, ":@");
+	type = rgbled_chain_type(spec, len, &chain->encoding);
+	if (!type) {
+		fprintf(stderr, "%s: unknown panel type\n", layout);
+		return -1;
+	}
+	end = (char *)spec + len;
+	if (*end == ':')
+		width = strtoul(end + 1, &end, 0);
+	if (*end == '@')
+		panels = strtoul(end + 1, &end, 0);
+	if (*end || !panels || (width && !(type->flags &
+					    RGBLED_FLAG_CHANGE_WIDTH))) {
+		fprintf(stderr, "%s: invalid layout\n", layout);
+		return -1;
+	}
+
+	chain->panels = calloc(panels, sizeof(*chain->panels));
+	if (!chain->panels) {
+		fprintf(stderr, "out of memory\n");
+		return -1;
+	}
+
+	/* the panels as the device tree would register them */
+	for (i = 0; i < panels; i++) {
+		panel = &chain->panels[i];
+		*panel = *type;
+		if (width)
+			panel->width = width;
+		if (!panel->get_pixel_coords)
+			panel->get_pixel_coords =
+				rgbled_get_pixel_coords_linear;
+		panel->pixel = panel->width * panel->height;
+		panel->y = chain->height;
+		panel->output_pixel = chain->pixel;
+		panel->index = i;
+
+		chain->height += panel->height;
+		if (panel->width > chain->width)
+			chain->width = panel->width;
+		chain->pixel += panel->pixel;
+	}
+	chain->panel_count = panels;
+
+	for (c = 0; c < 3; c++)
+		for (i = 0; i < RGBLED_GAMMA_SIZE; i++)
+			chain->lut[c][i] = i;
+
+	chain->map = calloc(chain->pixel, sizeof(*chain->map));
+	if (!chain->map) {
+		fprintf(stderr, "out of memory\n");
+		rgbled_chain_free(chain);
+		return -1;
+	}
+	rgbled_chain_map(chain);
+
+	return 0;
+}
+
+void rgbled_chain_free(struct rgbled_chain *chain)
+{
+	free(chain->map);
+	free(chain->panels);
+	memset(chain, 0, sizeof(*chain));
+}
+
+void rgbled_chain_map(struct rgbled_chain *chain)
+{
+	struct rgbled_panel_info *panel;
+	struct rgbled_coordinates coord;
+	u32 *map = chain->map;
+	u32 p;
+	int i;
+
+	for (p = 0; p < chain->panel_count; p++) {
+		panel = &chain->panels[p];
+		for (i = 0; i < panel->pixel; i++, map++) {
+			panel->get_pixel_coords(NULL, panel, i, &coord);
+			if ((coord.x < 0) || (coord.x >= chain->width) ||
+			    (coord.y < 0) || (coord.y >= chain->height))
+				*map = RGBLED_PIXEL_MAP_BLACK;
+			else
+				*map = coord.y * chain->width + coord.x;
+		}
+	}
+}
+
+void rgbled_chain_gather(const struct rgbled_chain *chain,
+			 const struct rgbled_pixel *screen,
+			 struct rgbled_pixel *leds)
+{
+	const u8 (*lut)[RGBLED_GAMMA_SIZE] = chain->lut;
+	const struct rgbled_pixel *pix;
+	u32 i;
+
+	for (i = 0; i < chain->pixel; i++, leds++) {
+		if (chain->map[i] == RGBLED_PIXEL_MAP_BLACK) {
+			memset(leds, 0, sizeof(*leds));
+			continue;
+		}
+		pix = &screen[chain->map[i]];
+		leds->red = lut[rgbled_pixeltype_red][pix->red];
+		leds->green = lut[rgbled_pixeltype_green][pix->green];
+		leds->blue = lut[rgbled_pixeltype_blue][pix->blue];
+		leds->brightness = pix->brightness;
+	}
+}
+
+size_t rgbled_chain_frame_len(const struct rgbled_chain *chain)
+{
+	if (chain->encoding == rgbled_chain_apa102)
+		return rgbled_apa102_frame_len(chain->pixel);
+
+	return rgbled_ws2812_frame_len(chain->pixel);
+}
+
+void rgbled_chain_frame_init(const struct rgbled_chain *chain, void *frame)
+{
+	if (chain->encoding == rgbled_chain_apa102)
+		rgbled_apa102_frame_init(frame, chain->pixel);
+	else
+		memset(frame, 0, rgbled_ws2812_frame_len(chain->pixel));
+}
+
+void rgbled_chain_encode(const struct rgbled_chain *chain,
+			 const struct rgbled_pixel *leds, u8 *grb,
+			 void *frame)
+{
+	/* the apa102 start frame goes first */
+	if (chain->encoding == rgbled_chain_apa102)
+		rgbled_encode_apa102((struct apa102_pixel *)frame + 1, leds,
+				     chain->pixel);
+	else
+		rgbled_encode_ws2812(frame, grb, leds, chain->pixel);
+}
@@ -0,0 +1,92 @@
+/*
+ *  tools/rgbled-chain.h
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  a led chain laid out in userspace with the panel types, coordinate
+ *  mapping and encoders of the core - no kernel or spi bus involved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef __RGBLED_CHAIN_H
+#define __RGBLED_CHAIN_H
+
+/* needs the kernel api shim in tools/shim on the include path */
+#include "rgbled-fb.h"
+
+/* the encoding of the driver the panel type belongs to */
+enum rgbled_chain_encoding {
+	rgbled_chain_ws2812,
+	rgbled_chain_apa102,
+};
+
+/**
+ * struct rgbled_chain - panels of a single type chained on one output
+ * @layout: the layout the chain got created from
+ * @encoding: the encoding of the spi data
+ * @width: width of the screen
+ * @height: height of the screen
+ * @pixel: number of leds in the chain
+ * @panel_count: number of panels
+ * @panels: the panels in chain order - stacked top to bottom
+ * @map: the screen offset of every led in chain order
+ *       (RGBLED_PIXEL_MAP_BLACK for leds outside of the screen)
+ * @lut: the transfer curves applied when gathering (identity)
+ */
+struct rgbled_chain {
+	const char		*layout;
+	enum rgbled_chain_encoding encoding;
+	u32			width;
+	u32			height;
+	u32			pixel;
+	u32			panel_count;
+	struct rgbled_panel_info *panels;
+	u32			*map;
+	u8			lut[3][RGBLED_GAMMA_SIZE];
+};
+
+/* lay out a chain - layout is either one of the standard layouts:
+ *   8x8    a single adafruit 8x8 meander matrix
+ *   32x8   four adafruit 32x8 matrices (layout-y-x) stacked to 32x32
+ *   strip  a ws2812b strip of 10000 leds
+ *   apa102 an apa102 strip of 300 leds
+ * or a panel type of the drivers with an optional width (for strips)
+ * and number of panels: compatible[:width][@panels]
+ * returns 0 or -1 with the reason reported on stderr
+ */
+int rgbled_chain_init(struct rgbled_chain *chain, const char *layout);
+void rgbled_chain_free(struct rgbled_chain *chain);
+
+/* (re)compute the map - what the core does once at registration */
+void rgbled_chain_map(struct rgbled_chain *chain);
+
+/* the leds in chain order from a screen of width * height pixel
+ * - what the core does for every frame before encoding
+ */
+void rgbled_chain_gather(const struct rgbled_chain *chain,
+			 const struct rgbled_pixel *screen,
+			 struct rgbled_pixel *leds);
+
+/* the length of the spi data of a frame - as transmitted by the driver */
+size_t rgbled_chain_frame_len(const struct rgbled_chain *chain);
+
+/* the spi data before the first frame - start frame, trailer, latch */
+void rgbled_chain_frame_init(const struct rgbled_chain *chain, void *frame);
+
+/* encode the leds in chain order into the spi data of an initialized
+ * frame - grb takes the ws2812 channels (3 bytes per led)
+ */
+void rgbled_chain_encode(const struct rgbled_chain *chain,
+			 const struct rgbled_pixel *leds, u8 *grb,
+			 void *frame);
+
+#endif /* __RGBLED_CHAIN_H */
@@ -0,0 +1,314 @@
+/*
+ *  tools/rgbled-latency.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  measures write-to-light latency and frame interval jitter of a
+ *  rgbled framebuffer
+ *
+ *  Every frame the whole screen gets stamped with a frame counter via
+ *  mmap (or write) and the time of the submission gets taken. The
+ *  completion of the frame is taken from the kernel side: frame_count
+ *  in sysfs gets polled and frame_timestamp is the time the frame got
+ *  latched on all outputs. With the captured data of the simulated spi
+ *  bus the stamp also gets decoded again, so it is certain that the
+ *  frame measured is the one that got stamped.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "rgbled-fb-decode.h"
+#include "rgbled-tool.h"
+
+/* the maximum size of a capture - the record_size of rgbled-spi-sim */
+#define LATENCY_CAPTURE_SIZE	(16 << 20)
+/* frames to wait for the stamp to show up in the capture */
+#define LATENCY_MAX_LATE	4
+/* log2 buckets of the jitter histogram */
+#define LATENCY_BUCKETS		40
+
+struct latency_decode {
+	bool found;
+	uint32_t led;
+};
+
+static void latency_decode_emit(void *context,
+				const struct rgbled_ws2812_token *tok)
+{
+	struct latency_decode *dec = context;
+
+	if ((tok->type == rgbled_ws2812_token_led) && !dec->found) {
+		dec->found = true;
+		dec->led = tok->value;
+	}
+}
+
+/* set a channel of a pixel - 8 or 16 bit */
+static void latency_set_channel(uint8_t *pix,
+				const struct fb_bitfield *field, uint8_t val)
+{
+	if (field->length == 16) {
+		pix[field->offset / 8] = 0;
+		pix[field->offset / 8 + 1] = val;
+	} else if (field->length == 8) {
+		pix[field->offset / 8] = val;
+	}
+}
+
+/* the stamp as red, green and blue */
+static void latency_stamp(struct rgbled_tool_fb *fb, uint8_t *screen,
+			  uint32_t stamp)
+{
+	size_t bytes = fb->var.bits_per_pixel / 8;
+	uint8_t pix[8];
+	uint32_t x, y;
+
+	memset(pix, 0, sizeof(pix));
+	latency_set_channel(pix, &fb->var.red, stamp);
+	latency_set_channel(pix, &fb->var.green, stamp >> 8);
+	latency_set_channel(pix, &fb->var.blue, stamp >> 16);
+	latency_set_channel(pix, &fb->var.transp, 0xff);
+
+	for (y = 0; y < fb->var.yres; y++)
+		for (x = 0; x < fb->var.xres; x++)
+			memcpy(screen + y * fb->fix.line_length + x * bytes,
+			       pix, bytes);
+}
+
+/* the stamp as the decoded 0xGGRRBB of a ws2812 */
+static uint32_t latency_stamp_grb(uint32_t stamp)
+{
+	return ((stamp & 0xff00) << 8) | ((stamp & 0xff) << 8) |
+	       ((stamp >> 16) & 0xff);
+}
+
+static int latency_cmp(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int64_t latency_percentile(const int64_t *sorted, unsigned int n,
+				  double p)
+{
+	unsigned int i = p * (n - 1) / 100 + 0.5;
+
+	return sorted[i < n ? i : n - 1];
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -d DEV    framebuffer device (default /dev/fb0)\n"
+		"  -n N      number of frames (default 1000)\n"
+		"  -r HZ     submit at this rate (default 0 - right after\n"
+		"            the previous frame got transmitted)\n"
+		"  -w        stamp via write instead of mmap\n"
+		"  -c FILE   spi capture of a ws2812 output to verify the stamp\n"
+		"            e.g. /sys/kernel/debug/rgbled-spi-sim.0/last-frame-cs0\n"
+		"            (needed for the latency - without it only the frame\n"
+		"            interval and its jitter get reported)\n"
+		"  -s HZ     spi speed for the latch detection (default 2400000)\n",
+		prog);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *dev = "/dev/fb0", *capture_path = NULL;
+	unsigned int frames = 1000, rate = 0, late = 0, unverified = 0;
+	unsigned long speed = 2400000;
+	unsigned int i, n, nl = 0, b, hist[LATENCY_BUCKETS];
+	int64_t *latency, *interval, submit, done, previous = 0, next;
+	int64_t median, dev_ns;
+	double mean, var;
+	struct latency_decode dec;
+	struct rgbled_tool_fb fb;
+	struct timespec ts;
+	bool use_write = false;
+	uint8_t *screen, *capture = NULL;
+	ssize_t len;
+	int opt, tries;
+
+	while ((opt = getopt(argc, argv, "d:n:r:wc:s:")) != -1) {
+		switch (opt) {
+		case 'd':
+			dev = optarg;
+			break;
+		case 'n':
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			rate = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			use_write = true;
+			break;
+		case 'c':
+			capture_path = optarg;
+			break;
+		case 's':
+			speed = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if ((optind != argc) || (frames < 2))
+		usage(argv[0]);
+
+	if (rgbled_tool_open(&fb, dev))
+		return 1;
+
+	/* the visible screen - written in place or via write */
+	if (use_write) {
+		screen = malloc(fb.frame_size);
+	} else {
+		screen = mmap(NULL, fb.fix.smem_len, PROT_READ | PROT_WRITE,
+			      MAP_SHARED, fb.fd, 0);
+		if (screen == MAP_FAILED)
+			screen = NULL;
+		else
+			screen += (size_t)fb.var.yoffset * fb.fix.line_length;
+	}
+	latency = calloc(frames, sizeof(*latency));
+	interval = calloc(frames, sizeof(*interval));
+	if (capture_path)
+		capture = malloc(LATENCY_CAPTURE_SIZE);
+	if (!screen || !latency || !interval || (capture_path && !capture)) {
+		fprintf(stderr, "%s: %s\n", dev, strerror(errno));
+		return 1;
+	}
+
+	next = rgbled_tool_now();
+	for (i = 0, n = 0; i < frames; i++) {
+		/* at a fixed rate - or back to back */
+		if (rate) {
+			next += 1000000000 / rate;
+			ts.tv_sec = next / 1000000000;
+			ts.tv_nsec = next % 1000000000;
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+					NULL);
+		}
+
+		rgbled_tool_frame_count(&fb);
+		submit = rgbled_tool_now();
+		latency_stamp(&fb, screen, i + 1);
+		if (use_write &&
+		    (pwrite(fb.fd, screen, fb.frame_size,
+			    (off_t)fb.var.yoffset * fb.fix.line_length) < 0)) {
+			fprintf(stderr, "%s: %s\n", dev, strerror(errno));
+			return 1;
+		}
+
+		/* wait for the frame carrying the stamp */
+		for (tries = 0; tries < LATENCY_MAX_LATE; tries++) {
+			if (rgbled_tool_wait_frame(&fb, 1000) < 0) {
+				fprintf(stderr, "frame %u: not transmitted\n",
+					i);
+				return 1;
+			}
+			done = rgbled_tool_frame_timestamp(&fb);
+			if (!capture)
+				break;
+
+			len = rgbled_tool_read_file(capture_path, capture,
+						    LATENCY_CAPTURE_SIZE);
+			if (len < 0)
+				return 1;
+			memset(&dec, 0, sizeof(dec));
+			rgbled_ws2812_decode(capture, len,
+					     (uint64_t)speed *
+					     RGBLED_WS2812_LATCH_NS /
+					     1000000000,
+					     latency_decode_emit, &dec);
+			if (dec.found && (dec.led == latency_stamp_grb(i + 1)))
+				break;
+			late++;
+		}
+		/* only a frame known to carry the stamp has a latency */
+		if (tries == LATENCY_MAX_LATE)
+			unverified++;
+		else if (capture)
+			latency[nl++] = done - submit;
+
+		if (previous)
+			interval[n++] = done - previous;
+		previous = done;
+	}
+
+	/* latency percentiles - without a capture the frame that got
+	 * transmitted next may have been started before the stamp
+	 */
+	if (!capture) {
+		printf("latency: not measured - needs a capture (-c) to find the frame carrying the stamp\n");
+	} else if (!nl) {
+		printf("latency: no stamp found in %u frames\n", frames);
+	} else {
+		qsort(latency, nl, sizeof(*latency), latency_cmp);
+		printf("latency (write to latched) in us over %u frames:\n",
+		       nl);
+		printf("  min %.1f p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f\n",
+		       latency[0] / 1e3,
+		       latency_percentile(latency, nl, 50) / 1e3,
+		       latency_percentile(latency, nl, 90) / 1e3,
+		       latency_percentile(latency, nl, 99) / 1e3,
+		       latency_percentile(latency, nl, 99.9) / 1e3,
+		       latency[nl - 1] / 1e3);
+	}
+
+	/* interval and jitter */
+	for (i = 0, mean = 0; i < n; i++)
+		mean += interval[i];
+	mean /= n;
+	for (i = 0, var = 0; i < n; i++)
+		var += (interval[i] - mean) * (interval[i] - mean);
+	qsort(interval, n, sizeof(*interval), latency_cmp);
+	median = latency_percentile(interval, n, 50);
+	printf("interval in us:\n");
+	printf("  min %.1f median %.1f mean %.1f max %.1f stddev %.1f\n",
+	       interval[0] / 1e3, median / 1e3, mean / 1e3,
+	       interval[n - 1] / 1e3, sqrt(var / n) / 1e3);
+
+	/* log2 histogram of the deviation from the median */
+	memset(hist, 0, sizeof(hist));
+	for (i = 0; i < n; i++) {
+		dev_ns = llabs(interval[i] - median);
+		for (b = 0; (b < LATENCY_BUCKETS - 1) && (dev_ns >> (b + 1));
+		     b++)
+			;
+		hist[b]++;
+	}
+	printf("jitter (deviation from the median interval):\n");
+	for (b = 0; b < LATENCY_BUCKETS; b++)
+		if (hist[b])
+			printf("  >= %12lld ns: %u\n",
+			       b ? 1LL << b : 0LL, hist[b]);
+
+	if (capture) {
+		printf("frames transmitted before the stamp: %u\n", late);
+		printf("stamps not found: %u\n", unverified);
+	}
+
+	return unverified ? 1 : 0;
+}
@@ -0,0 +1,376 @@
+/*
+ *  tools/rgbled-replay.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  replays raw frames through a rgbled framebuffer and checks the
+ *  transmitted spi data against golden hashes
+ *
+ *  Every frame gets written to the framebuffer, which encodes it and
+ *  transmits it on the (simulated) spi bus. Once the frame got
+ *  transmitted the data captured by rgbled-spi-sim is hashed with the
+ *  same crc32 the frames file of the simulated bus shows, and for
+ *  ws2812 also decoded back into LED values (which get hashed as well).
+ *  So any change of the encoding shows up as a changed hash, while the
+ *  time until each frame got transmitted gives the sustained frame rate.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rgbled-chain.h"
+#include "rgbled-fb-decode.h"
+#include "rgbled-tool.h"
+
+/* the maximum number of captured chip-selects (outputs) */
+#define REPLAY_CAPTURES		8
+/* the maximum size of a capture - the record_size of rgbled-spi-sim */
+#define REPLAY_CAPTURE_SIZE	(16 << 20)
+
+/**
+ * struct replay_hash - what gets compared for a frame and capture
+ * @crc: crc32 of the spi data
+ * @leds: number of decoded LEDs
+ * @led_crc: crc32 of the decoded LED values
+ * @errors: invalid symbols, gaps and LEDs cut short
+ */
+struct replay_hash {
+	uint32_t crc;
+	uint32_t leds;
+	uint32_t led_crc;
+	uint32_t errors;
+};
+
+/**
+ * struct replay_decode - the state of decoding a capture
+ * @hash: the hash getting computed
+ * @grb: the channel values the leds must show (NULL if unknown)
+ * @pixel: the number of leds in @grb
+ */
+struct replay_decode {
+	struct replay_hash *hash;
+	const uint8_t *grb;
+	uint32_t pixel;
+};
+
+static void replay_decode_emit(void *context,
+			       const struct rgbled_ws2812_token *tok)
+{
+	struct replay_decode *decode = context;
+	struct replay_hash *hash = decode->hash;
+	const uint8_t *grb;
+
+	switch (tok->type) {
+	case rgbled_ws2812_token_led:
+		/* offline the leds have to show exactly what got encoded */
+		if (decode->grb && (hash->leds < decode->pixel)) {
+			grb = &decode->grb[hash->leds * 3];
+			if (tok->value != ((uint32_t)grb[0] << 16 |
+					   grb[1] << 8 | grb[2]))
+				hash->errors++;
+		}
+		hash->led_crc = rgbled_tool_crc32(hash->led_crc, &tok->value,
+						  sizeof(tok->value));
+		hash->leds++;
+		break;
+	case rgbled_ws2812_token_latch:
+		break;
+	default:
+		hash->errors++;
+		break;
+	}
+}
+
+/**
+ * struct replay_offline - frames encoded by the shared code of the core
+ * @chain: the layout of the leds
+ * @leds: the leds of the frame in chain order
+ * @grb: the ws2812 channel values of the frame
+ * @frame: the spi data of the frame
+ * @len: the length of @frame
+ */
+struct replay_offline {
+	struct rgbled_chain chain;
+	struct rgbled_pixel *leds;
+	uint8_t *grb;
+	uint8_t *frame;
+	size_t len;
+};
+
+static int replay_offline_init(struct replay_offline *off,
+			       const char *layout)
+{
+	if (rgbled_chain_init(&off->chain, layout))
+		return -1;
+
+	off->len = rgbled_chain_frame_len(&off->chain);
+	off->leds = calloc(off->chain.pixel, sizeof(*off->leds));
+	off->grb = calloc(off->chain.pixel, 3);
+	off->frame = malloc(off->len);
+	if (!off->leds || !off->grb || !off->frame) {
+		fprintf(stderr, "out of memory\n");
+		return -1;
+	}
+	rgbled_chain_frame_init(&off->chain, off->frame);
+
+	return 0;
+}
+
+/* a frame as the driver would transmit it after data got written */
+static void replay_offline_frame(struct replay_offline *off,
+				 const void *data)
+{
+	rgbled_chain_gather(&off->chain, data, off->leds);
+	rgbled_chain_encode(&off->chain, off->leds, off->grb, off->frame);
+}
+
+/* a single write is a single frame - as long as nothing else
+ * (e.g. dithering) produces frames
+ */
+static int replay_write_frame(struct rgbled_tool_fb *fb, const char *dev,
+			      const void *data, unsigned int frame)
+{
+	rgbled_tool_frame_count(fb);
+	if (pwrite(fb->fd, data, fb->frame_size,
+		   (off_t)fb->var.yoffset * fb->fix.line_length) < 0) {
+		fprintf(stderr, "%s: %s\n", dev, strerror(errno));
+		return -1;
+	}
+	if (rgbled_tool_wait_frame(fb, 1000) < 0) {
+		fprintf(stderr, "frame %u: not transmitted\n", frame);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] frames.raw\n"
+		"  -d DEV    framebuffer device (default /dev/fb0)\n"
+		"  -L LAYOUT encode offline - without framebuffer and spi bus\n"
+		"            (a layout of rgbled-bench, e.g. 8x8)\n"
+		"  -c FILE   spi capture - e.g. /sys/kernel/debug/rgbled-spi-sim.0/last-frame-cs0\n"
+		"            (may be given once per output)\n"
+		"  -g FILE   golden hashes to compare with\n"
+		"  -w        write the golden hashes instead of comparing\n"
+		"  -r        raw spi data only - no ws2812 decoding (e.g. apa102)\n"
+		"  -s HZ     spi speed for the latch detection (default 2400000)\n"
+		"  -l N      replay the frames N times (default 1)\n"
+		"\n"
+		"frames.raw holds the frames back to back, each the size of\n"
+		"the visible screen in the framebuffer format\n"
+		"offline the spi data of the layout is hashed as output 0, and\n"
+		"the decoded ws2812 leds get checked against the frame\n", prog);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *dev = "/dev/fb0", *golden = NULL, *layout = NULL;
+	const char *captures[REPLAY_CAPTURES];
+	struct replay_hash hash, expected;
+	struct replay_decode decode = { .hash = &hash };
+	struct replay_offline off;
+	struct rgbled_tool_fb fb;
+	size_t frame_size;
+	unsigned int frame, loops = 1, loop, c, f, cap;
+	unsigned int ncaptures = 0, mismatches = 0, errors = 0;
+	unsigned long speed = 2400000;
+	int64_t start, busy = 0, wall;
+	bool write_golden = false, raw = false;
+	FILE *frames, *gold = NULL;
+	uint8_t *data, *capture;
+	const uint8_t *spi;
+	ssize_t len;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:L:c:g:wrs:l:")) != -1) {
+		switch (opt) {
+		case 'd':
+			dev = optarg;
+			break;
+		case 'L':
+			layout = optarg;
+			break;
+		case 'c':
+			if (ncaptures == REPLAY_CAPTURES)
+				usage(argv[0]);
+			captures[ncaptures++] = optarg;
+			break;
+		case 'g':
+			golden = optarg;
+			break;
+		case 'w':
+			write_golden = true;
+			break;
+		case 'r':
+			raw = true;
+			break;
+		case 's':
+			speed = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			loops = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if ((optind != argc - 1) || (write_golden && !golden) ||
+	    (layout && ncaptures))
+		usage(argv[0]);
+
+	if (layout) {
+		if (replay_offline_init(&off, layout))
+			return 1;
+		frame_size = off.chain.width * off.chain.height *
+			     sizeof(struct rgbled_pixel);
+		raw = off.chain.encoding != rgbled_chain_ws2812;
+		ncaptures = 1;
+	} else {
+		if (rgbled_tool_open(&fb, dev))
+			return 1;
+		frame_size = fb.frame_size;
+	}
+
+	frames = fopen(argv[optind], "r");
+	if (!frames) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+		return 1;
+	}
+	if (golden) {
+		gold = fopen(golden, write_golden ? "w" : "r");
+		if (!gold) {
+			fprintf(stderr, "%s: %s\n", golden, strerror(errno));
+			return 1;
+		}
+	}
+
+	data = malloc(frame_size);
+	capture = malloc(REPLAY_CAPTURE_SIZE);
+	if (!data || !capture) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	wall = rgbled_tool_now();
+	for (loop = 0, frame = 0; loop < loops; loop++) {
+		rewind(frames);
+		while (fread(data, frame_size, 1, frames) == 1) {
+			start = rgbled_tool_now();
+			if (layout)
+				replay_offline_frame(&off, data);
+			else if (replay_write_frame(&fb, dev, data, frame))
+				return 1;
+			busy += rgbled_tool_now() - start;
+
+			/* hash what got transmitted */
+			for (c = 0; c < ncaptures; c++) {
+				if (layout) {
+					spi = off.frame;
+					len = off.len;
+					decode.grb = off.grb;
+					decode.pixel = off.chain.pixel;
+				} else {
+					spi = capture;
+					len = rgbled_tool_read_file(
+						captures[c], capture,
+						REPLAY_CAPTURE_SIZE);
+					if (len < 0)
+						return 1;
+				}
+
+				memset(&hash, 0, sizeof(hash));
+				hash.crc = rgbled_tool_crc32(0, spi, len);
+				if (!raw)
+					rgbled_ws2812_decode(
+						spi, len,
+						(uint64_t)speed *
+						RGBLED_WS2812_LATCH_NS /
+						1000000000,
+						replay_decode_emit, &decode);
+				/* every led - and not more */
+				if (!raw && decode.grb &&
+				    (hash.leds != decode.pixel))
+					hash.errors++;
+				if (hash.errors) {
+					fprintf(stderr,
+						"frame %u output %u: %u decode errors\n",
+						frame, c, hash.errors);
+					errors++;
+				}
+
+				/* only the first loop is compared */
+				if (!gold || loop)
+					continue;
+				if (write_golden) {
+					fprintf(gold, "%u %u %08x %u %08x\n",
+						frame, c, hash.crc, hash.leds,
+						hash.led_crc);
+					continue;
+				}
+				if ((fscanf(gold, "%u %u %x %u %x", &f, &cap,
+					    &expected.crc, &expected.leds,
+					    &expected.led_crc) != 5) ||
+				    (f != frame) || (cap != c)) {
+					fprintf(stderr,
+						"%s: no hash for frame %u output %u\n",
+						golden, frame, c);
+					return 1;
+				}
+				if ((hash.crc != expected.crc) ||
+				    (hash.leds != expected.leds) ||
+				    (hash.led_crc != expected.led_crc)) {
+					fprintf(stderr,
+						"frame %u output %u: %08x %u %08x - expected %08x %u %08x\n",
+						frame, c, hash.crc, hash.leds,
+						hash.led_crc, expected.crc,
+						expected.leds,
+						expected.led_crc);
+					mismatches++;
+				}
+			}
+			frame++;
+		}
+	}
+	wall = rgbled_tool_now() - wall;
+
+	if (!frame) {
+		fprintf(stderr, "%s: no complete frame of %zu bytes\n",
+			argv[optind], frame_size);
+		return 1;
+	}
+
+	printf("frames:      %u\n", frame);
+	printf("frames/s:    %.1f (%s)\n", frame * 1e9 / busy,
+	       layout ? "encoding" : "write to transmitted");
+	printf("frames/s:    %.1f (including hashing)\n", frame * 1e9 / wall);
+	if (gold && !write_golden)
+		printf("mismatches:  %u\n", mismatches);
+	if (!raw && ncaptures)
+		printf("with errors: %u\n", errors);
+	if (layout)
+		rgbled_chain_free(&off.chain);
+
+	if (gold)
+		fclose(gold);
+	fclose(frames);
+
+	return (mismatches || errors) ? 1 : 0;
+}
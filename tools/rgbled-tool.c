@@ -0,0 +1,165 @@
+/*
+ *  tools/rgbled-tool.c
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  helpers shared by the userspace tools for rgbled framebuffers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "rgbled-tool.h"
+
+static int rgbled_tool_open_sysfs(const char *dev, const char *attr)
+{
+	const char *name = strrchr(dev, '/');
+	char path[256];
+	int fd;
+
+	snprintf(path, sizeof(path), "/sys/class/graphics/%s/%s",
+		 name ? name + 1 : dev, attr);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+
+	return fd;
+}
+
+int rgbled_tool_open(struct rgbled_tool_fb *fb, const char *dev)
+{
+	memset(fb, 0, sizeof(*fb));
+
+	fb->fd = open(dev, O_RDWR);
+	if (fb->fd < 0) {
+		fprintf(stderr, "%s: %s\n", dev, strerror(errno));
+		return -1;
+	}
+
+	if (ioctl(fb->fd, FBIOGET_VSCREENINFO, &fb->var) ||
+	    ioctl(fb->fd, FBIOGET_FSCREENINFO, &fb->fix)) {
+		fprintf(stderr, "%s: no framebuffer: %s\n", dev,
+			strerror(errno));
+		return -1;
+	}
+	fb->frame_size = (size_t)fb->fix.line_length * fb->var.yres;
+
+	fb->count_fd = rgbled_tool_open_sysfs(dev, "frame_count");
+	fb->timestamp_fd = rgbled_tool_open_sysfs(dev, "frame_timestamp");
+	if ((fb->count_fd < 0) || (fb->timestamp_fd < 0))
+		return -1;
+
+	rgbled_tool_frame_count(fb);
+
+	return 0;
+}
+
+static int64_t rgbled_tool_read_sysfs(int fd)
+{
+	char buf[32];
+	ssize_t len;
+
+	/* reading from the start re-arms poll for sysfs_notify */
+	len = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (len <= 0)
+		return -1;
+	buf[len] = 0;
+
+	return strtoll(buf, NULL, 0);
+}
+
+uint32_t rgbled_tool_frame_count(struct rgbled_tool_fb *fb)
+{
+	fb->count = rgbled_tool_read_sysfs(fb->count_fd);
+
+	return fb->count;
+}
+
+int64_t rgbled_tool_wait_frame(struct rgbled_tool_fb *fb, int timeout)
+{
+	struct pollfd pfd = {
+		.fd = fb->count_fd,
+		.events = POLLPRI | POLLERR,
+	};
+	uint32_t count = fb->count;
+
+	/* a notification may be for a frame we already know about */
+	while (rgbled_tool_frame_count(fb) == count) {
+		if (poll(&pfd, 1, timeout) <= 0)
+			return -1;
+	}
+
+	return fb->count;
+}
+
+int64_t rgbled_tool_frame_timestamp(struct rgbled_tool_fb *fb)
+{
+	return rgbled_tool_read_sysfs(fb->timestamp_fd);
+}
+
+int64_t rgbled_tool_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+ssize_t rgbled_tool_read_file(const char *path, void *buf, size_t size)
+{
+	ssize_t len, total = 0;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	while ((size_t)total < size) {
+		len = read(fd, (char *)buf + total, size - total);
+		if (len < 0) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			close(fd);
+			return -1;
+		}
+		if (!len)
+			break;
+		total += len;
+	}
+	close(fd);
+
+	return total;
+}
+
+uint32_t rgbled_tool_crc32(uint32_t crc, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	int i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320 : 0);
+	}
+
+	return crc;
+}
@@ -0,0 +1,72 @@
+/*
+ *  tools/rgbled-tool.h
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  helpers shared by the userspace tools for rgbled framebuffers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef __RGBLED_TOOL_H
+#define __RGBLED_TOOL_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <stdint.h>
+#include <linux/fb.h>
+
+/**
+ * struct rgbled_tool_fb - an opened rgbled framebuffer
+ * @fd: the file descriptor of /dev/fbN
+ * @count_fd: sysfs frame_count - polled for frame completion
+ * @timestamp_fd: sysfs frame_timestamp
+ * @var: the variable screen info
+ * @fix: the fixed screen info
+ * @frame_size: size of the visible screen in bytes
+ * @count: the frame_count read last
+ */
+struct rgbled_tool_fb {
+	int			fd;
+	int			count_fd;
+	int			timestamp_fd;
+	struct fb_var_screeninfo var;
+	struct fb_fix_screeninfo fix;
+	size_t			frame_size;
+	uint32_t		count;
+};
+
+/* open /dev/fbN and its sysfs frame_count/frame_timestamp */
+int rgbled_tool_open(struct rgbled_tool_fb *fb, const char *dev);
+
+/* the current frame_count - which also arms the poll for the next one */
+uint32_t rgbled_tool_frame_count(struct rgbled_tool_fb *fb);
+
+/* wait until frame_count moved past fb->count - returns the new count
+ * or -1 on timeout (in ms)
+ */
+int64_t rgbled_tool_wait_frame(struct rgbled_tool_fb *fb, int timeout);
+
+/* the CLOCK_MONOTONIC time in ns the last frame got transmitted */
+int64_t rgbled_tool_frame_timestamp(struct rgbled_tool_fb *fb);
+
+/* CLOCK_MONOTONIC in ns */
+int64_t rgbled_tool_now(void);
+
+/* read a whole (debugfs) file into buf - returns the length or -1 */
+ssize_t rgbled_tool_read_file(const char *path, void *buf, size_t size);
+
+/* the same crc32 as crc32_le(0, ...) of the kernel - as shown by the
+ * frames file of the simulated spi bus
+ */
+uint32_t rgbled_tool_crc32(uint32_t crc, const void *data, size_t len);
+
+#endif /* __RGBLED_TOOL_H */
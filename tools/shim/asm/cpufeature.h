@@ -0,0 +1,8 @@
+/* userspace shim - see linux/kernel.h */
+#ifndef __RGBLED_SHIM_CPUFEATURE_H
+#define __RGBLED_SHIM_CPUFEATURE_H
+
+#define X86_FEATURE_SSSE3	"ssse3"
+#define boot_cpu_has(feature)	__builtin_cpu_supports(feature)
+
+#endif /* __RGBLED_SHIM_CPUFEATURE_H */
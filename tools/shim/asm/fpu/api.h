@@ -0,0 +1,11 @@
+/* userspace shim - see linux/kernel.h
+ * userspace may always use the fpu
+ */
+#ifndef __RGBLED_SHIM_FPU_API_H
+#define __RGBLED_SHIM_FPU_API_H
+
+#define irq_fpu_usable()	true
+#define kernel_fpu_begin()	do { } while (0)
+#define kernel_fpu_end()	do { } while (0)
+
+#endif /* __RGBLED_SHIM_FPU_API_H */
@@ -0,0 +1,16 @@
+/* userspace shim - see linux/kernel.h */
+#ifndef __RGBLED_SHIM_ATOMIC_H
+#define __RGBLED_SHIM_ATOMIC_H
+
+typedef struct {
+	int counter;
+} atomic_t;
+
+#define atomic_inc(v)		__atomic_add_fetch(&(v)->counter, 1, \
+						   __ATOMIC_RELAXED)
+#define atomic_dec(v)		__atomic_sub_fetch(&(v)->counter, 1, \
+						   __ATOMIC_RELAXED)
+#define smp_mb__before_atomic()	__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define smp_mb__after_atomic()	__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#endif /* __RGBLED_SHIM_ATOMIC_H */
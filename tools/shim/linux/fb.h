@@ -0,0 +1,24 @@
+/* userspace shim - see linux/kernel.h
+ * the uapi part of fb.h plus the kernel structures rgbled-fb.h embeds
+ */
+#ifndef __RGBLED_SHIM_FB_H
+#define __RGBLED_SHIM_FB_H
+
+#include_next <linux/fb.h>
+#include <linux/kernel.h>
+
+struct device;
+
+struct kobject {
+	const char *name;
+};
+
+struct fb_info {
+	void *par;
+};
+
+struct fb_deferred_io {
+	unsigned long delay;
+};
+
+#endif /* __RGBLED_SHIM_FB_H */
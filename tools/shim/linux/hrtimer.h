@@ -0,0 +1,13 @@
+/* userspace shim - see linux/kernel.h */
+#ifndef __RGBLED_SHIM_HRTIMER_H
+#define __RGBLED_SHIM_HRTIMER_H
+
+#include <linux/kernel.h>
+
+typedef s64 ktime_t;
+
+struct hrtimer {
+	ktime_t expires;
+};
+
+#endif /* __RGBLED_SHIM_HRTIMER_H */
@@ -0,0 +1,41 @@
+/*
+ *  tools/shim/linux/kernel.h
+ *
+ *  (c) Martin Sperl <kernel@martin.sperl.org>
+ *
+ *  a thin shim of the kernel api, just enough to compile the parts of
+ *  the core that do not touch any kernel service (panel geometry and
+ *  the encoders) in userspace - rgbled-fb.h included
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef __RGBLED_SHIM_KERNEL_H
+#define __RGBLED_SHIM_KERNEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int64_t s64;
+
+#define BIT(nr)			(1UL << (nr))
+#define ARRAY_SIZE(arr)		(sizeof(arr) / sizeof((arr)[0]))
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+/* only used with unsigned values */
+#define DIV_ROUND_CLOSEST(x, d)	(((x) + ((d) / 2)) / (d))
+
+#endif /* __RGBLED_SHIM_KERNEL_H */
@@ -0,0 +1,9 @@
+/* userspace shim - see linux/kernel.h */
+#ifndef __RGBLED_SHIM_LIST_H
+#define __RGBLED_SHIM_LIST_H
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#endif /* __RGBLED_SHIM_LIST_H */
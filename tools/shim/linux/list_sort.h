@@ -0,0 +1,2 @@
+/* userspace shim - see linux/kernel.h */
+#include <linux/list.h>
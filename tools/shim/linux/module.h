@@ -0,0 +1,7 @@
+/* userspace shim - see linux/kernel.h */
+#ifndef __RGBLED_SHIM_MODULE_H
+#define __RGBLED_SHIM_MODULE_H
+
+#define EXPORT_SYMBOL_GPL(sym)
+
+#endif /* __RGBLED_SHIM_MODULE_H */
@@ -0,0 +1,17 @@
+/* userspace shim - see linux/kernel.h */
+#ifndef __RGBLED_SHIM_SPI_H
+#define __RGBLED_SHIM_SPI_H
+
+#include <linux/list.h>
+
+struct spi_transfer {
+	const void *tx_buf;
+	unsigned int len;
+};
+
+struct spi_message {
+	struct list_head transfers;
+	bool pre_optimized;
+};
+
+#endif /* __RGBLED_SHIM_SPI_H */
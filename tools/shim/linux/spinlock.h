@@ -0,0 +1,9 @@
+/* userspace shim - see linux/kernel.h */
+#ifndef __RGBLED_SHIM_SPINLOCK_H
+#define __RGBLED_SHIM_SPINLOCK_H
+
+typedef struct {
+	int locked;
+} spinlock_t;
+
+#endif /* __RGBLED_SHIM_SPINLOCK_H */
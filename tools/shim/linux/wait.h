@@ -0,0 +1,11 @@
+/* userspace shim - see linux/kernel.h */
+#ifndef __RGBLED_SHIM_WAIT_H
+#define __RGBLED_SHIM_WAIT_H
+
+#include <linux/list.h>
+
+typedef struct {
+	struct list_head head;
+} wait_queue_head_t;
+
+#endif /* __RGBLED_SHIM_WAIT_H */
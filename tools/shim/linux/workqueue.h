@@ -0,0 +1,11 @@
+/* userspace shim - see linux/kernel.h */
+#ifndef __RGBLED_SHIM_WORKQUEUE_H
+#define __RGBLED_SHIM_WORKQUEUE_H
+
+#include <linux/list.h>
+
+struct work_struct {
+	struct list_head entry;
+};
+
+#endif /* __RGBLED_SHIM_WORKQUEUE_H */
@@ -25,62 +25,18 @@
  *  GNU General Public License for more details.
  */
 
+#include <linux/debugfs.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
+#include <linux/seq_file.h>
 #include <linux/spi/spi.h>
 
 #include "rgbled-fb.h"
+#include "rgbled-fb-decode.h"
 
 #define DEVICE_NAME "ws2812b-spi-fb"
 
-/* encoded byte tables
- * we present each bit as 3 bits (oversampling by a factor of 3)
- *   zero is represented as 0b100
- *   one is represented as 0b110
- * so each byte is actually represented as 3 bytes
- *
- * the following are tables to avoid repeated computations
- * and are sent via spi as high, medium, low at 3* required HZ
- */
-const char byte2encoding_h[/* (value >> 5) & 0x07 */] = {
-	0x92,
-	0x93,
-	0x9a,
-	0x9b,
-	0xd2,
-	0xd3,
-	0xda,
-	0xdb
-};
-
-const char byte2encoding_m[/* (value >> 3) & 0x03 */] = {
-	0x49,
-	0x4d,
-	0x69,
-	0x6d
-};
-
-const char byte2encoding_l[/* value & 0x07 */] = {
-	0x24,
-	0x26,
-	0x34,
-	0x36,
-	0xa4,
-	0xa6,
-	0xb4,
-	0xb6
-};
-
-/* an encoded rgb-pixel */
-struct ws2812b_encoding {
-	u8 h, m, l;
-};
-
-struct ws2812b_pixel {
-	struct ws2812b_encoding g, r, b;
-};
-
 /* generic information about this device */
 struct ws2812b_device_info {
 	char *name;
@@ -92,98 +48,251 @@ struct ws2812b_device_info {
 	u32 led_current_base;
 };
 
+/* the data of an individual output */
+struct ws2812b_output {
+	u8 *grb;
+	u32 pixel;
+	struct rgbled_spi_output spi_out;
+};
+
 /* the private data structure for this device */
 struct ws2812b_data {
 	struct spi_device *spi;
 	struct rgbled_fb *rgbled_fb;
-	struct ws2812b_pixel *spi_data;
-	struct spi_message spi_msg;
-	struct spi_transfer spi_xfer;
+	struct ws2812b_output *outputs;
 };
 
 static const struct of_device_id ws2812b_of_match[];
 
-/* implementation details */
-static inline void ws2812b_set_encoded_pixel(struct ws2812b_encoding *enc,
-					     u8 val)
+static void ws2812b_set_pixel_values(struct rgbled_fb *rfb,
+				     struct rgbled_panel_info *panel,
+				     int pixel_num,
+				     const struct rgbled_pixel *pix,
+				     int count)
 {
-	enc->h = byte2encoding_h[(val >> 5) & 0x07];
-	enc->m = byte2encoding_m[(val >> 3) & 0x03];
-	enc->l = byte2encoding_l[(val >> 0) & 0x07];
+	struct ws2812b_data *bs = rfb->par;
+	struct ws2812b_output *out = &bs->outputs[panel->output];
+	struct ws2812b_pixel *data = rgbled_spi_output_buffer(&out->spi_out);
+
+	rgbled_encode_ws2812(&data[pixel_num], &out->grb[pixel_num * 3],
+			     pix, count);
 }
 
-static void ws2812b_set_pixel_value(struct rgbled_fb *rfb,
-				    struct rgbled_panel_info *panel,
-				    int pixel_num,
-				    struct rgbled_pixel *pix)
+static void ws2812b_finish_work(struct rgbled_fb *rfb)
 {
 	struct ws2812b_data *bs = rfb->par;
-	struct ws2812b_pixel *spix = &bs->spi_data[pixel_num];
+	struct rgbled_panel_info *panel;
+	int i;
+
+	/* the panels that did not get encoded stay as they were */
+	list_for_each_entry(panel, &rfb->panels, list)
+		if (!panel->dirty)
+			rgbled_spi_output_keep(
+				&bs->outputs[panel->output].spi_out,
+				panel->output_pixel *
+				sizeof(struct ws2812b_pixel),
+				panel->pixel * sizeof(struct ws2812b_pixel));
+
+	/* hand the frame to the spi outputs - not waiting for them,
+	 * so outputs on separate spi buses transmit concurrently
+	 */
+	for (i = 0; i < rfb->outputs; i++)
+		rgbled_spi_output_submit(&bs->outputs[i].spi_out);
+}
 
-	int r = pix->red   * pix->brightness / 255;
-	int g = pix->green * pix->brightness / 255;
-	int b = pix->blue  * pix->brightness / 255;
+/* decoding of the last encoded frame of an output via debugfs */
+struct ws2812b_decode_state {
+	struct seq_file *m;
+	u32 leds;
+	u32 errors;
+};
 
-	/* assign the encoded values */
-	ws2812b_set_encoded_pixel(&spix->g, g);
-	ws2812b_set_encoded_pixel(&spix->r, r);
-	ws2812b_set_encoded_pixel(&spix->b, b);
+static void ws2812b_decode_emit(void *context,
+				const struct rgbled_ws2812_token *tok)
+{
+	struct ws2812b_decode_state *state = context;
+	struct seq_file *m = state->m;
+
+	switch (tok->type) {
+	case rgbled_ws2812_token_led:
+		seq_printf(m, "%10zu led %u: r=%u g=%u b=%u\n", tok->bit,
+			   state->leds++, (tok->value >> 8) & 0xff,
+			   (tok->value >> 16) & 0xff, tok->value & 0xff);
+		break;
+	case rgbled_ws2812_token_latch:
+		seq_printf(m, "%10zu latch: low for %u bits\n",
+			   tok->bit, tok->value);
+		break;
+	case rgbled_ws2812_token_gap:
+		seq_printf(m, "%10zu error: low for %u bits - no latch\n",
+			   tok->bit, tok->value);
+		state->errors++;
+		break;
+	case rgbled_ws2812_token_symbol:
+		seq_printf(m, "%10zu error: invalid symbol %u%u%u\n",
+			   tok->bit, (tok->value >> 2) & 1,
+			   (tok->value >> 1) & 1, tok->value & 1);
+		state->errors++;
+		break;
+	case rgbled_ws2812_token_partial:
+		seq_printf(m, "%10zu error: led cut short after %u bits\n",
+			   tok->bit, tok->value);
+		state->errors++;
+		break;
+	}
 }
 
-static void ws2812b_finish_work(struct rgbled_fb *rfb)
+static int ws2812b_decode_show(struct seq_file *m, void *v)
 {
-	struct ws2812b_data *bs = rfb->par;
+	struct ws2812b_output *out = m->private;
+	struct ws2812b_decode_state state = { .m = m };
+	u32 speed = out->spi_out.spi->max_speed_hz;
+	const void *data = rgbled_spi_output_last(&out->spi_out);
+	u32 latch_bits;
+
+	if (!data)
+		return 0;
+
+	/* the trailer is sized for the latch at 2.4MHz */
+	latch_bits = speed ? div_u64((u64)RGBLED_WS2812_LATCH_NS * speed,
+				     NSEC_PER_SEC) : 120;
+
+	/* racing with the next frames getting submitted - good enough
+	 * for a debugging aid
+	 */
+	rgbled_ws2812_decode(data, out->spi_out.len,
+			     latch_bits, ws2812b_decode_emit, &state);
+	seq_printf(m, "%u leds (expected %u), %u errors\n",
+		   state.leds, out->pixel, state.errors);
+
+	return 0;
+}
+
+static int ws2812b_decode_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ws2812b_decode_show, inode->i_private);
+}
+
+static const struct file_operations ws2812b_decode_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ws2812b_decode_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* the files go away with the debugfs directory of the framebuffer */
+static void ws2812b_register_debugfs(struct ws2812b_data *bs)
+{
+	struct rgbled_fb *rfb = bs->rgbled_fb;
+	char name[32];
+	int i;
+
+	if (!rfb->debugfs)
+		return;
+
+	for (i = 0; i < rfb->outputs; i++) {
+		snprintf(name, sizeof(name), "decode-output%i", i);
+		debugfs_create_file(name, 0444, rfb->debugfs,
+				    &bs->outputs[i], &ws2812b_decode_fops);
+	}
+}
+
+static int ws2812b_probe_output(struct ws2812b_data *bs, u32 output)
+{
+	struct rgbled_fb *rfb = bs->rgbled_fb;
+	struct ws2812b_output *out = &bs->outputs[output];
+	struct device *dev = &bs->spi->dev;
+	struct spi_device *spi;
+	u32 pixel = rgbled_output_pixel(rfb, output);
+	int len, err;
+
+	/* a gap in the output numbers leaves an output without leds */
+	if (!pixel) {
+		dev_err(dev, "output %u has no panels connected\n", output);
+		return -EINVAL;
+	}
+
+	spi = rgbled_spi_output_device(rfb, bs->spi, output);
+	if (IS_ERR(spi))
+		return PTR_ERR(spi);
+
+	/* set up the spi-message and buffers */
+	out->pixel = pixel;
+	len = rgbled_ws2812_frame_len(pixel);
 
-	/* just issue spi_sync */
-	spi_sync(bs->spi, &bs->spi_msg);
+	/* the channel values of the chain prior to encoding */
+	out->grb = rgbled_devm_vzalloc(dev, pixel * 3);
+	if (!out->grb)
+		return -ENOMEM;
+
+	/* setting up SPI - the frames get encoded right into the
+	 * transmit buffers of the output, the zeroed tail is the latch
+	 * long chains get split only between encoded bytes: a short
+	 * pause there just stretches a low period, which stays far
+	 * below the latch time
+	 */
+	err = rgbled_spi_output_init(&out->spi_out, rfb, spi, len,
+				     sizeof(struct ws2812b_encoding), NULL);
+	if (err)
+		return err;
+
+	return 0;
 }
 
 static int ws2812b_probe(struct spi_device *spi)
 {
+	struct rgbled_platform_data *pdata = dev_get_platdata(&spi->dev);
 	struct ws2812b_data *bs;
-	int len;
+	int i, err;
 	const struct of_device_id *of_id;
+	const struct spi_device_id *id;
 	const struct ws2812b_device_info *dinfo;
 	struct rgbled_fb *rfb;
 
-	/* get the panels for this panel */
+	/* get the panels for this panel - via device-tree or spi_device_id */
 	of_id = of_match_device(ws2812b_of_match, &spi->dev);
-	if (!of_id)
+	id = spi_get_device_id(spi);
+	if (of_id)
+		dinfo = (const struct ws2812b_device_info *)of_id->data;
+	else if (id)
+		dinfo = (const struct ws2812b_device_info *)id->driver_data;
+	else
 		return -EINVAL;
-	dinfo = (const struct ws2812b_device_info *)of_id->data;
+
+	/* without device-tree the layout comes with the platform data */
+	if ((!spi->dev.of_node) && (!pdata)) {
+		dev_err(&spi->dev, "no device-tree node or platform data\n");
+		return -EINVAL;
+	}
 
 	/* allocate our buffer */
 	bs = devm_kzalloc(&spi->dev, sizeof(*bs), GFP_KERNEL);
 	if (!bs)
 		return -ENOMEM;
 
-	rfb = rgbled_alloc(&spi->dev, dinfo->name, dinfo->panels);
+	rfb = rgbled_alloc(&spi->dev, dinfo->name,
+			   pdata ? pdata->panels : dinfo->panels);
 	bs->rgbled_fb = rfb;
 	if (!rfb)
 		return -ENOMEM;
 	if (IS_ERR(rfb))
 		return PTR_ERR(rfb);
 
-	/* set up the spi-message and buffers */
-	len = rfb->pixel * sizeof(struct ws2812b_pixel)
-		+ 15;
-	bs->spi_data = devm_kzalloc(&spi->dev, len, GFP_KERNEL);
-	if (!bs->spi_data)
-		return -ENOMEM;
-
-	/* setting up SPI */
+	/* set up the individual outputs */
 	bs->spi = spi;
-	spi_message_init(&bs->spi_msg);
-	bs->spi_xfer.len = len;
-	bs->spi_xfer.tx_buf = bs->spi_data;
-	spi_message_add_tail(&bs->spi_xfer, &bs->spi_msg);
-
-	/* and estimate the refresh rate */
-	rfb->deferred_io.delay = max_t(unsigned long, 1,
-				       HZ * len * 8 / spi->max_speed_hz);
+	bs->outputs = devm_kcalloc(&spi->dev, rfb->outputs,
+				   sizeof(*bs->outputs), GFP_KERNEL);
+	if (!bs->outputs)
+		return -ENOMEM;
+	for (i = 0; i < rfb->outputs; i++) {
+		err = ws2812b_probe_output(bs, i);
+		if (err)
+			return err;
+	}
 
 	/* setting up deferred work */
-	rfb->set_pixel_value = ws2812b_set_pixel_value;
+	rfb->set_pixel_values = ws2812b_set_pixel_values;
 	rfb->finish_work = ws2812b_finish_work;
 
 	/* copy the current values */
@@ -191,121 +300,21 @@ static int ws2812b_probe(struct spi_device *spi)
 	rfb->led_current_max_green = dinfo->led_current_max_green;
 	rfb->led_current_max_blue = dinfo->led_current_max_blue;
 	rfb->led_current_base = dinfo->led_current_base;
+	if (pdata)
+		rfb->current_limit = pdata->current_limit;
 
 	/* set the reverse pointer */
 	rfb->par = bs;
 
 	/* and register */
-	return rgbled_register(rfb);
-}
+	err = rgbled_register(rfb);
+	if (err)
+		return err;
 
-/* define the different panel types for the ws2812b chip*/
-static struct rgbled_panel_info ws2812b_panels[] = {
-	{
-		.compatible		= "worldsemi,ws2812b,strip",
-		.width			= 1,
-		.height			= 1,
-		.flags			= RGBLED_FLAG_CHANGE_WHLP,
-	},
-	{
-		.compatible		= "adafruit,neopixel,strip,30",
-		.width			= 1,
-		.height			= 1,
-		.pitch			= 30,
-		.flags			= RGBLED_FLAG_CHANGE_WHL,
-	},
-	{
-		.compatible		= "adafruit,neopixel,strip,60",
-		.width			= 1,
-		.height			= 1,
-		.pitch			= 60,
-		.flags			= RGBLED_FLAG_CHANGE_WHL,
-	},
-	{
-		.compatible		= "adafruit,neopixel,strip,144",
-		.width			= 1,
-		.height			= 1,
-		.pitch			= 144,
-		.flags			= RGBLED_FLAG_CHANGE_WHL,
-	},
-#ifdef VERIFIED_SETTINGS
-	{
-		.compatible		= "adafruit,neopixel,ring,12",
-		.pixel			= 12,
-		.width			= 6,
-		.height			= 6,
-/*
-		.get_pixel_coords	= ws2812b_get_pixel_coordinates_ring12,
-		.pitch			= 112,
-*/
+	ws2812b_register_debugfs(bs);
 
-	},
-	{
-		.compatible		= "adafruit,neopixel,ring,16",
-		.pixel			= 16,
-		.width			= 8,
-		.height			= 8,
-/*
-		.get_pixel_coords	= ws2812b_get_pixel_coordinates_ring16,
-		.pitch			= 112,
-*/
-	},
-	{
-		.compatible		= "adafruit,neopixel,ring,24",
-		.pixel			= 24,
-		.width			= 10,
-		.height			= 10,
-/*
-		.get_pixel_coords	= ws2812b_get_pixel_coordinates_ring24,
-		.pitch			= 112,
-*/
-	},
-	{
-		.compatible		= "adafruit,neopixel,arc,15",
-		.pixel			= 15,
-		.width			= 8,
-		.height			= 8,
-/*
-		.get_pixel_coords	= ws2812b_get_pixel_coordinates_arc15,
-		.pitch		= 112,
-*/
-	},
-#endif
-	{
-		.compatible		= "adafruit,neopixel,matrix,8x8",
-		.width			= 8,
-		.height			= 8,
-		.get_pixel_coords	= rgbled_get_pixel_coords_meander,
-		.pitch			= 112,
-		.multiple		= rgbled_panel_multiple_height,
-	},
-	{
-		.compatible		= "adafruit,neopixel,matrix,16x16",
-		.width			= 16,
-		.height			= 16,
-		.get_pixel_coords	= rgbled_get_pixel_coords_meander,
-		.pitch			= 112,
-		.multiple		= rgbled_panel_multiple_height,
-	},
-	{
-		.compatible		= "adafruit,neopixel,matrix,32x8",
-		.width			= 32,
-		.height			= 8,
-		.pixel			= 256,
-		.get_pixel_coords	= rgbled_get_pixel_coords_meander,
-		.layout_yx		= true,
-		.pitch			= 112,
-		.multiple		= rgbled_panel_multiple_width,
-	},
-	{
-		.compatible		= "adafruit,neopixel,stick,8",
-		.width			= 8,
-		.height			= 1,
-		.pitch			= 156,
-		.multiple		= rgbled_panel_multiple_height,
-	},
-	{ }
-};
+	return 0;
+}
 
 static struct ws2812b_device_info ws2812b_device_info = {
 	.name			= "ws2812b-spi-fb",
@@ -317,17 +326,6 @@ static struct ws2812b_device_info ws2812b_device_info = {
 	.led_current_base	= 1,
 };
 
-/* define the different panel types for the ws2812b chip*/
-static struct rgbled_panel_info ws2812_panels[] = {
-	{
-		.compatible		= "worldsemi,ws2812,strip",
-		.width			= 1,
-		.height			= 1,
-		.flags			= RGBLED_FLAG_CHANGE_WHLP,
-	},
-	{ }
-};
-
 static struct ws2812b_device_info ws2812_device_info = {
 	.name			= "ws2812-spi-fb",
 	.panels			= ws2812_panels,
@@ -352,12 +350,21 @@ static const struct of_device_id ws2812b_of_match[] = {
 };
 MODULE_DEVICE_TABLE(of, ws2812b_of_match);
 
+/* and the same for instantiation with platform data */
+static const struct spi_device_id ws2812b_id_table[] = {
+	{ "ws2812b", (kernel_ulong_t)&ws2812b_device_info },
+	{ "ws2812", (kernel_ulong_t)&ws2812_device_info },
+	{ }
+};
+MODULE_DEVICE_TABLE(spi, ws2812b_id_table);
+
 static struct spi_driver ws2812b_driver = {
 	.driver = {
 		.name = DEVICE_NAME,
 		.owner = THIS_MODULE,
 		.of_match_table = ws2812b_of_match,
 	},
+	.id_table = ws2812b_id_table,
 	.probe = ws2812b_probe,
 };
 module_spi_driver(ws2812b_driver);